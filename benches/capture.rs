@@ -0,0 +1,190 @@
+//! Benchmarks for the per-frame capture API surface.
+//!
+//! Runs against the in-process mock backend, so neither a GPU nor a RenderDoc installation is
+//! required. Besides the timings reported by Criterion, each benchmark prints the number of heap
+//! allocations performed per call.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::ffi::{CStr, OsStr};
+use std::os::raw::c_void;
+use std::path::{Path, PathBuf};
+use std::ptr;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::{Duration, Instant};
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use renderdoc::{mock, CaptureOption, DevicePointer, InputButton, RenderDoc, V141};
+
+/// Global allocator which counts every allocation made by the benchmark process.
+struct CountingAllocator;
+
+static ALLOCATIONS: AtomicU64 = AtomicU64::new(0);
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+const ALLOCATION_SAMPLES: u64 = 1_000;
+
+/// Number of iterations after which the mock's list of captures is cleared.
+const CAPTURES_PER_RESET: u64 = 10_000;
+
+/// Benchmarks `f` with Criterion and reports its average heap allocations per call.
+fn bench<O, F: FnMut() -> O>(c: &mut Criterion, name: &str, mut f: F) {
+    c.bench_function(name, |b| b.iter(&mut f));
+    report_allocations(name, f);
+}
+
+/// Prints the average number of heap allocations performed by a call to `f`.
+fn report_allocations<O, F: FnMut() -> O>(name: &str, mut f: F) {
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    for _ in 0..ALLOCATION_SAMPLES {
+        black_box(f());
+    }
+    let after = ALLOCATIONS.load(Ordering::Relaxed);
+
+    let per_call = (after - before) as f64 / ALLOCATION_SAMPLES as f64;
+    println!("{}: {:.2} allocations/call", name, per_call);
+}
+
+fn renderdoc() -> RenderDoc<V141> {
+    mock::enable();
+    mock::reset();
+    RenderDoc::new().expect("Failed to load mock")
+}
+
+fn frame_capture(c: &mut Criterion) {
+    let mut rd = renderdoc();
+
+    // Every iteration produces a capture, so the mock is periodically reset outside of the timed
+    // section to keep its memory usage bounded.
+    c.bench_function("start_end_frame_capture", |b| {
+        b.iter_custom(|iters| {
+            let mut elapsed = Duration::default();
+            let mut remaining = iters;
+            while remaining > 0 {
+                let batch = remaining.min(CAPTURES_PER_RESET);
+                let start = Instant::now();
+                for _ in 0..batch {
+                    rd.start_frame_capture(ptr::null(), ptr::null());
+                    rd.end_frame_capture(ptr::null(), ptr::null());
+                }
+                elapsed += start.elapsed();
+                remaining -= batch;
+                mock::reset();
+            }
+            elapsed
+        })
+    });
+
+    report_allocations("start_end_frame_capture", || {
+        rd.start_frame_capture(ptr::null(), ptr::null());
+        rd.end_frame_capture(ptr::null(), ptr::null());
+    });
+    mock::reset();
+
+    bench(c, "start_discard_frame_capture", || {
+        rd.start_frame_capture(ptr::null(), ptr::null());
+        rd.discard_frame_capture(ptr::null(), ptr::null())
+    });
+
+    bench(c, "begin_capture_drop", || {
+        drop(rd.begin_capture(ptr::null(), ptr::null()));
+    });
+
+    bench(c, "is_frame_capturing", || rd.is_frame_capturing());
+}
+
+fn captures(c: &mut Criterion) {
+    let mut rd = renderdoc();
+    rd.trigger_capture();
+
+    bench(c, "get_capture", || rd.get_capture(0));
+
+    let mut path = PathBuf::new();
+    bench(c, "get_capture_into", || rd.get_capture_into(0, &mut path));
+    bench(c, "get_capture_out_of_range", || {
+        rd.get_capture(u32::max_value())
+    });
+}
+
+fn settings(c: &mut Criterion) {
+    let mut rd = renderdoc();
+
+    let keys = [InputButton::F12, InputButton::PrtScrn];
+    bench(c, "set_capture_keys", || rd.set_capture_keys(&keys));
+
+    bench(c, "set_capture_file_comments", || {
+        rd.set_capture_file_comments(None, "Hitch in frame 1234")
+    });
+
+    bench(c, "get_capture_option_u32", || {
+        rd.get_capture_option_u32(CaptureOption::CaptureCallstacks)
+    });
+    bench(c, "get_overlay_bits", || rd.get_overlay_bits());
+    bench(c, "get_capture_option_u32_refresh", || {
+        rd.refresh();
+        rd.get_capture_option_u32(CaptureOption::CaptureCallstacks)
+    });
+}
+
+fn string_arguments(c: &mut Criterion) {
+    // The mock copies every path template it receives, so a disabled instance is used to count
+    // only the allocations made converting the arguments.
+    let mut rd = RenderDoc::<V141>::disabled();
+    let template = Path::new("/tmp/captures/game");
+    let comments = CStr::from_bytes_with_nul(b"Hitch in frame 1234\0").unwrap();
+
+    bench(c, "set_capture_file_path_template_str", || {
+        rd.set_capture_file_path_template("/tmp/captures/game")
+    });
+    bench(c, "set_capture_file_path_template_path", || {
+        rd.set_capture_file_path_template(template)
+    });
+    bench(c, "set_capture_file_path_template_os_str", || {
+        rd.set_capture_file_path_template(OsStr::new("/tmp/captures/game"))
+    });
+    bench(c, "set_capture_file_comments_c_str", || {
+        rd.set_capture_file_comments(template, comments)
+    });
+    bench(c, "launch_replay_ui_args", || {
+        rd.launch_replay_ui(true, "--help").is_ok()
+    });
+}
+
+fn device_pointer(c: &mut Criterion) {
+    let const_ptr = 0x1000 as *const c_void;
+    let mut_ptr = 0x2000 as *mut c_void;
+
+    bench(c, "device_pointer_from_const", || {
+        DevicePointer::from(black_box(const_ptr))
+    });
+    bench(c, "device_pointer_from_mut", || {
+        DevicePointer::from(black_box(mut_ptr))
+    });
+}
+
+criterion_group!(
+    benches,
+    frame_capture,
+    captures,
+    settings,
+    string_arguments,
+    device_pointer
+);
+criterion_main!(benches);
@@ -0,0 +1,143 @@
+//! Benchmarks for submitting capture requests from many threads.
+//!
+//! Compares the render thread's cost of applying requests via `CaptureController` against the
+//! naive alternative of sharing a mutex-guarded queue with the requesting threads. Besides the
+//! mean timings reported by Criterion, each benchmark prints the worst-case time the render thread
+//! spent in a single drain, which is where lock contention shows up.
+
+use std::mem;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::{Arc, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use criterion::{criterion_group, criterion_main, Criterion};
+use renderdoc::{mock, CaptureCommand, CaptureController, CaptureOption, RenderDoc, V120};
+
+const PRODUCERS: usize = 32;
+
+/// Number of drains sampled when measuring the worst case.
+const LATENCY_SAMPLES: u32 = 100_000;
+
+/// Approximate pause between two requests made by the same thread.
+const SUBMIT_INTERVAL: Duration = Duration::from_micros(20);
+
+/// A set of threads which keep submitting requests until dropped.
+struct Producers {
+    stop: Arc<AtomicBool>,
+    threads: Vec<JoinHandle<()>>,
+}
+
+impl Producers {
+    fn spawn<F>(count: usize, submit: F) -> Self
+    where
+        F: Fn(u32) + Clone + Send + 'static,
+    {
+        let stop = Arc::new(AtomicBool::new(false));
+        let threads = (0..count)
+            .map(|_| {
+                let stop = stop.clone();
+                let submit = submit.clone();
+                thread::spawn(move || {
+                    let mut n = 0;
+                    while !stop.load(Ordering::Relaxed) {
+                        submit(n);
+                        n = n.wrapping_add(1);
+
+                        let start = Instant::now();
+                        while start.elapsed() < SUBMIT_INTERVAL {
+                            thread::yield_now();
+                        }
+                    }
+                })
+            })
+            .collect();
+
+        Producers { stop, threads }
+    }
+}
+
+impl Drop for Producers {
+    fn drop(&mut self) {
+        self.stop.store(true, Ordering::Relaxed);
+        for thread in self.threads.drain(..) {
+            thread.join().unwrap();
+        }
+    }
+}
+
+fn renderdoc() -> RenderDoc<V120> {
+    mock::enable();
+    mock::reset();
+    RenderDoc::new().expect("Failed to load mock")
+}
+
+fn request(n: u32) -> CaptureCommand {
+    CaptureCommand::SetCaptureOptionU32(CaptureOption::DelayForDebugger, n % 2)
+}
+
+/// Prints the worst-case duration of a call to `drain`.
+fn report_worst_case<F: FnMut() -> usize>(name: &str, mut drain: F) {
+    let mut worst = Duration::default();
+    let mut applied = 0;
+    for _ in 0..LATENCY_SAMPLES {
+        let start = Instant::now();
+        applied += drain();
+        worst = worst.max(start.elapsed());
+    }
+
+    println!(
+        "{}: worst drain {:?} over {} drains, {} requests applied",
+        name, worst, LATENCY_SAMPLES, applied
+    );
+}
+
+fn lock_free(c: &mut Criterion) {
+    let mut rd = renderdoc();
+    let mut controller = CaptureController::new();
+
+    c.bench_function("lock_free_drain_idle", |b| {
+        b.iter(|| controller.drain(&mut rd))
+    });
+    report_worst_case("lock_free_drain_idle", || controller.drain(&mut rd));
+
+    let handle = controller.handle();
+    let producers = Producers::spawn(PRODUCERS, move |n| handle.submit(request(n)));
+
+    c.bench_function("lock_free_drain_32_producers", |b| {
+        b.iter(|| controller.drain(&mut rd))
+    });
+    report_worst_case("lock_free_drain_32_producers", || controller.drain(&mut rd));
+
+    drop(producers);
+}
+
+fn mutex(c: &mut Criterion) {
+    let mut rd = renderdoc();
+    let queue = Arc::new(Mutex::new(Vec::new()));
+    let shared = queue.clone();
+    let mut batch = Vec::new();
+
+    let mut drain = move |rd: &mut RenderDoc<V120>| {
+        mem::swap(&mut *queue.lock().unwrap(), &mut batch);
+        let count = batch.len();
+        for command in batch.drain(..) {
+            if let CaptureCommand::SetCaptureOptionU32(opt, val) = command {
+                rd.set_capture_option_u32(opt, val);
+            }
+        }
+        count
+    };
+
+    let producers = Producers::spawn(PRODUCERS, move |n| {
+        shared.lock().unwrap().push(request(n));
+    });
+
+    c.bench_function("mutex_drain_32_producers", |b| b.iter(|| drain(&mut rd)));
+    report_worst_case("mutex_drain_32_producers", || drain(&mut rd));
+
+    drop(producers);
+}
+
+criterion_group!(benches, lock_free, mutex);
+criterion_main!(benches);
@@ -0,0 +1,113 @@
+//! Benchmarks for ending frame captures on a `CaptureWorker`.
+//!
+//! Runs against the in-process mock backend, with an artificial latency injected into
+//! `EndFrameCapture` to emulate RenderDoc serializing a capture to disk. Besides the round trip
+//! timings reported by Criterion, the benchmark prints how long the render thread is blocked per
+//! captured frame when ending captures directly versus through the worker.
+
+use std::cell::{Cell, RefCell};
+use std::ptr;
+use std::time::{Duration, Instant};
+
+use criterion::{criterion_group, criterion_main, Criterion};
+use renderdoc::mock::{self, Function};
+use renderdoc::{CaptureWorker, PendingCapture, RenderDoc, V141};
+
+/// Latency injected into `EndFrameCapture`.
+const SERIALIZE_LATENCY: Duration = Duration::from_millis(5);
+
+/// Number of captured frames sampled per strategy.
+const FRAMES: u32 = 50;
+
+/// Number of round trips after which the mock's list of captures is cleared.
+const CAPTURES_PER_RESET: u32 = 10_000;
+
+fn renderdoc() -> RenderDoc<V141> {
+    mock::enable();
+    mock::reset();
+    RenderDoc::new().expect("Failed to load mock")
+}
+
+/// Prints the mean and worst-case time the render thread spent in `end`, per captured frame.
+///
+/// `settle` runs untimed after every frame, standing in for the uncaptured frames rendered until
+/// the capture has been written.
+fn report_render_thread<E, S>(name: &str, mut end: E, mut settle: S)
+where
+    E: FnMut(&mut RenderDoc<V141>),
+    S: FnMut(),
+{
+    let mut rd = renderdoc();
+    mock::set_latency(Function::EndFrameCapture, SERIALIZE_LATENCY);
+
+    let mut total = Duration::default();
+    let mut worst = Duration::default();
+    for _ in 0..FRAMES {
+        rd.start_frame_capture(ptr::null(), ptr::null());
+        let start = Instant::now();
+        end(&mut rd);
+        let elapsed = start.elapsed();
+        total += elapsed;
+        worst = worst.max(elapsed);
+        settle();
+    }
+
+    println!(
+        "{}: render thread blocked {:?} on average, {:?} at worst",
+        name,
+        total / FRAMES,
+        worst
+    );
+}
+
+fn render_thread(_: &mut Criterion) {
+    report_render_thread(
+        "blocking_end_frame_capture",
+        |rd| rd.end_frame_capture(ptr::null(), ptr::null()),
+        || {},
+    );
+
+    let worker = CaptureWorker::new(&renderdoc());
+    let pending = RefCell::new(None);
+    let finished = Cell::new(0);
+    report_render_thread(
+        "worker_end_frame_capture",
+        |_| *pending.borrow_mut() = Some(worker.end_frame_capture(ptr::null(), ptr::null())),
+        || {
+            if let Some(Ok(_)) = pending.borrow_mut().take().map(PendingCapture::wait) {
+                finished.set(finished.get() + 1);
+            }
+        },
+    );
+
+    let stats = worker.stats();
+    println!(
+        "worker_end_frame_capture: {} captures finished, {:?} of stall moved off the render \
+         thread ({:?} at worst)",
+        finished.get(),
+        stats.total_stall,
+        stats.max_stall
+    );
+}
+
+fn round_trip(c: &mut Criterion) {
+    let mut rd = renderdoc();
+    let worker = CaptureWorker::new(&rd);
+
+    let mut captures = 0;
+    c.bench_function("worker_round_trip", |b| {
+        b.iter(|| {
+            captures += 1;
+            if captures % CAPTURES_PER_RESET == 0 {
+                mock::reset();
+            }
+
+            rd.start_frame_capture(ptr::null(), ptr::null());
+            worker.end_frame_capture(ptr::null(), ptr::null()).wait()
+        })
+    });
+    mock::reset();
+}
+
+criterion_group!(benches, render_thread, round_trip);
+criterion_main!(benches);
@@ -0,0 +1,44 @@
+//! Benchmarks for per-frame instrumentation on a disabled `RenderDoc` instance.
+//!
+//! By default this measures the runtime fallback used by `RenderDoc::new_or_disabled()`, where
+//! every call goes through a table of inert stubs. Run with `--features disabled` to measure the
+//! compile-time backend instead, where the instrumented frame should cost the same as the empty
+//! baseline.
+
+use std::ptr;
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use renderdoc::{RenderDoc, V141};
+
+/// Instrumentation typically left in a render loop.
+fn instrumented_frame(rd: &mut RenderDoc<V141>, frame: u64) {
+    rd.start_frame_capture(ptr::null(), ptr::null());
+    black_box(frame);
+    if rd.is_frame_capturing() {
+        rd.end_frame_capture(ptr::null(), ptr::null());
+    } else {
+        rd.discard_frame_capture(ptr::null(), ptr::null());
+    }
+}
+
+fn disabled(c: &mut Criterion) {
+    let mut rd = black_box(RenderDoc::<V141>::disabled());
+    let mut frame = 0;
+
+    c.bench_function("empty_frame", |b| {
+        b.iter(|| {
+            frame += 1;
+            black_box(frame);
+        })
+    });
+
+    c.bench_function("disabled_instrumented_frame", |b| {
+        b.iter(|| {
+            frame += 1;
+            instrumented_frame(&mut rd, frame);
+        })
+    });
+}
+
+criterion_group!(benches, disabled);
+criterion_main!(benches);
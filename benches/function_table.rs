@@ -0,0 +1,129 @@
+//! Compares calling through the raw `Entry` structure against the pre-resolved function table.
+//!
+//! Uses a stand-in entry point populated with no-op functions, so no RenderDoc installation is
+//! required to run it.
+
+use std::os::raw::{c_char, c_int, c_void};
+use std::ptr;
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use renderdoc::{Entry, RenderDoc, V141};
+
+unsafe extern "C" fn get_api_version(major: *mut c_int, minor: *mut c_int, patch: *mut c_int) {
+    *major = 1;
+    *minor = 4;
+    *patch = 1;
+}
+
+unsafe extern "C" fn set_option_u32(_: u32, _: u32) -> c_int {
+    1
+}
+
+unsafe extern "C" fn set_option_f32(_: u32, _: f32) -> c_int {
+    1
+}
+
+unsafe extern "C" fn get_option_u32(_: u32) -> u32 {
+    0
+}
+
+unsafe extern "C" fn get_option_f32(_: u32) -> f32 {
+    0.0
+}
+
+unsafe extern "C" fn set_keys(_: *mut u32, _: c_int) {}
+
+unsafe extern "C" fn get_u32() -> u32 {
+    0
+}
+
+unsafe extern "C" fn mask_overlay_bits(_: u32, _: u32) {}
+
+unsafe extern "C" fn no_args() {}
+
+unsafe extern "C" fn set_path(_: *const c_char) {}
+
+unsafe extern "C" fn get_path() -> *const c_char {
+    b"\0".as_ptr() as *const c_char
+}
+
+unsafe extern "C" fn get_capture(_: u32, _: *mut c_char, _: *mut u32, _: *mut u64) -> u32 {
+    0
+}
+
+unsafe extern "C" fn launch_replay_ui(_: u32, _: *const c_char) -> u32 {
+    0
+}
+
+unsafe extern "C" fn set_active_window(_: *mut c_void, _: *mut c_void) {}
+
+unsafe extern "C" fn frame_capture(_: *mut c_void, _: *mut c_void) -> u32 {
+    1
+}
+
+unsafe extern "C" fn trigger_multi_frame_capture(_: u32) {}
+
+unsafe extern "C" fn set_comments(_: *const c_char, _: *const c_char) {}
+
+fn stand_in_entry() -> Entry {
+    unsafe {
+        let mut entry: Entry = std::mem::zeroed();
+        entry.GetAPIVersion = Some(get_api_version);
+        entry.SetCaptureOptionU32 = Some(set_option_u32);
+        entry.SetCaptureOptionF32 = Some(set_option_f32);
+        entry.GetCaptureOptionU32 = Some(get_option_u32);
+        entry.GetCaptureOptionF32 = Some(get_option_f32);
+        entry.SetFocusToggleKeys = Some(set_keys);
+        entry.SetCaptureKeys = Some(set_keys);
+        entry.GetOverlayBits = Some(get_u32);
+        entry.MaskOverlayBits = Some(mask_overlay_bits);
+        entry.__bindgen_anon_1.RemoveHooks = Some(no_args);
+        entry.UnloadCrashHandler = Some(no_args);
+        entry.__bindgen_anon_2.SetCaptureFilePathTemplate = Some(set_path);
+        entry.__bindgen_anon_3.GetCaptureFilePathTemplate = Some(get_path);
+        entry.GetNumCaptures = Some(get_u32);
+        entry.GetCapture = Some(get_capture);
+        entry.TriggerCapture = Some(no_args);
+        entry.__bindgen_anon_4.IsTargetControlConnected = Some(get_u32);
+        entry.LaunchReplayUI = Some(launch_replay_ui);
+        entry.SetActiveWindow = Some(set_active_window);
+        entry.StartFrameCapture = Some(set_active_window);
+        entry.IsFrameCapturing = Some(get_u32);
+        entry.EndFrameCapture = Some(frame_capture);
+        entry.TriggerMultiFrameCapture = Some(trigger_multi_frame_capture);
+        entry.SetCaptureFileComments = Some(set_comments);
+        entry.DiscardFrameCapture = Some(frame_capture);
+        entry
+    }
+}
+
+fn frame_capture_round_trip(c: &mut Criterion) {
+    let mut entry = stand_in_entry();
+    let entry_ptr: *mut Entry = &mut entry;
+
+    c.bench_function("entry_unwrap/start_end_frame_capture", |b| {
+        b.iter(|| unsafe {
+            let api = black_box(entry_ptr);
+            ((*api).StartFrameCapture.unwrap())(ptr::null_mut(), ptr::null_mut());
+            let capturing = ((*api).IsFrameCapturing.unwrap())() == 1;
+            ((*api).EndFrameCapture.unwrap())(ptr::null_mut(), ptr::null_mut());
+            capturing
+        })
+    });
+
+    let mut rd: RenderDoc<V141> =
+        unsafe { RenderDoc::from_raw(entry_ptr).expect("Stand-in entry is incomplete") };
+
+    c.bench_function("function_table/start_end_frame_capture", |b| {
+        b.iter(|| {
+            let rd = black_box(&mut rd);
+            rd.start_frame_capture(ptr::null(), ptr::null());
+            let capturing = rd.is_frame_capturing();
+            rd.end_frame_capture(ptr::null(), ptr::null());
+            capturing
+        })
+    });
+}
+
+criterion_group!(benches, frame_capture_round_trip);
+criterion_main!(benches);
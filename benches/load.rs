@@ -0,0 +1,42 @@
+//! Benchmarks for constructing additional `RenderDoc` handles.
+//!
+//! Compares the cached entry point lookup performed by `RenderDoc::new()` against requesting the
+//! entry point from `RENDERDOC_GetAPI` on every call. Runs against the in-process mock backend,
+//! whose `RENDERDOC_GetAPI` skips the `dlsym` lookup made with the real library, so the uncached
+//! timings are a lower bound. Each benchmark also prints how often `RENDERDOC_GetAPI` was called.
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use renderdoc::mock::{self, Function};
+use renderdoc::{Error, RenderDoc, Version, V141};
+
+const SAMPLES: u64 = 1_000;
+
+/// Benchmarks `f` with Criterion and reports its average number of `RENDERDOC_GetAPI` calls.
+fn bench<O, F: FnMut() -> O>(c: &mut Criterion, name: &str, mut f: F) {
+    c.bench_function(name, |b| b.iter(&mut f));
+
+    let before = mock::call_count(Function::GetApi);
+    for _ in 0..SAMPLES {
+        black_box(f());
+    }
+    let after = mock::call_count(Function::GetApi);
+
+    let per_call = (after - before) as f64 / SAMPLES as f64;
+    println!("{}: {:.2} GetAPI calls/call", name, per_call);
+}
+
+fn new_uncached() -> Result<RenderDoc<V141>, Error> {
+    unsafe { RenderDoc::from_raw(V141::load_uncached()?) }
+}
+
+fn load(c: &mut Criterion) {
+    mock::enable();
+
+    bench(c, "version_load_cached", V141::load);
+    bench(c, "version_load_uncached", V141::load_uncached);
+    bench(c, "renderdoc_new_cached", RenderDoc::<V141>::new);
+    bench(c, "renderdoc_new_uncached", new_uncached);
+}
+
+criterion_group!(benches, load);
+criterion_main!(benches);
@@ -0,0 +1,113 @@
+//! Benchmarks for listing the metadata of a directory of capture files with `RdcFile`.
+//!
+//! Generates synthetic captures whose frame capture section is a large sparse region, so that the
+//! files are as big as real captures without using the disk space. Reading the metadata should
+//! only touch the header and section table, making the scan time independent of the file size.
+
+use std::env;
+use std::fs::{self, File};
+use std::io::{self, Seek, SeekFrom, Write};
+use std::path::{Path, PathBuf};
+use std::process;
+
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use renderdoc::rdc::{RdcFile, SectionType};
+
+/// Number of synthetic captures in the scanned directory.
+const CAPTURES: usize = 64;
+
+/// Size of the frame capture section of every synthetic capture.
+const FRAME_CAPTURE_LEN: u64 = 512 * 1024 * 1024;
+
+/// Writes a binary section header for a section of `len` bytes.
+fn section_header<W: Write>(w: &mut W, section_type: u32, flags: u32, name: &str, len: u64) {
+    let mut header = vec![0u8; 4];
+    header.extend_from_slice(&section_type.to_le_bytes());
+    header.extend_from_slice(&len.to_le_bytes());
+    header.extend_from_slice(&len.to_le_bytes());
+    header.extend_from_slice(&1u64.to_le_bytes());
+    header.extend_from_slice(&flags.to_le_bytes());
+    header.extend_from_slice(&(name.len() as u32 + 1).to_le_bytes());
+    header.extend_from_slice(name.as_bytes());
+    header.push(0);
+    w.write_all(&header).unwrap();
+}
+
+fn write_capture(path: &Path, index: usize) -> io::Result<()> {
+    let driver = if index % 2 == 0 { "Vulkan" } else { "D3D12" };
+    let thumbnail = vec![0xa5; 16 * 1024];
+
+    let mut file = File::create(path)?;
+    let header_len = 32 + 8 + thumbnail.len() + 13 + driver.len();
+    file.write_all(b"RDOC\0\0\0\0")?;
+    file.write_all(&0x102u32.to_le_bytes())?;
+    file.write_all(&(header_len as u32).to_le_bytes())?;
+    file.write_all(b"v1.15\0\0\0\0\0\0\0\0\0\0\0")?;
+    file.write_all(&[0, 1, 0, 1])?;
+    file.write_all(&(thumbnail.len() as u32).to_le_bytes())?;
+    file.write_all(&thumbnail)?;
+    file.write_all(&(index as u64).to_le_bytes())?;
+    file.write_all(&2u32.to_le_bytes())?;
+    file.write_all(&[driver.len() as u8])?;
+    file.write_all(driver.as_bytes())?;
+
+    section_header(
+        &mut file,
+        1,
+        0x4,
+        "renderdoc/internal/framecapture",
+        FRAME_CAPTURE_LEN,
+    );
+    file.seek(SeekFrom::Current(FRAME_CAPTURE_LEN as i64))?;
+
+    let notes = format!("Synthetic capture {}\0", index);
+    section_header(&mut file, 4, 0, "renderdoc/ui/notes", notes.len() as u64);
+    file.write_all(notes.as_bytes())
+}
+
+fn generate() -> PathBuf {
+    let dir = env::temp_dir().join(format!("renderdoc-rs-rdc-scan-{}", process::id()));
+    fs::create_dir_all(&dir).expect("Failed to create capture directory");
+    for index in 0..CAPTURES {
+        let path = dir.join(format!("synthetic_frame{}.rdc", index));
+        write_capture(&path, index).expect("Failed to write synthetic capture");
+    }
+
+    dir
+}
+
+/// Lists the metadata of every capture in `dir`, returning the number of sections seen.
+fn scan(dir: &Path) -> usize {
+    let mut sections = 0;
+    for entry in fs::read_dir(dir).unwrap() {
+        let rdc = RdcFile::open(entry.unwrap().path()).unwrap();
+        black_box(rdc.driver_name());
+        black_box(rdc.thumbnail());
+        black_box(rdc.comments());
+        black_box(rdc.section(SectionType::FrameCapture));
+        sections += rdc.sections().len();
+    }
+
+    sections
+}
+
+fn rdc_scan(c: &mut Criterion) {
+    let dir = generate();
+    println!(
+        "rdc_scan: {} captures of {} MiB each",
+        CAPTURES,
+        FRAME_CAPTURE_LEN / (1024 * 1024)
+    );
+
+    c.bench_function("scan_directory", |b| b.iter(|| scan(&dir)));
+
+    let first = dir.join("synthetic_frame0.rdc");
+    c.bench_function("open_single", |b| {
+        b.iter(|| RdcFile::open(&first).unwrap().sections().len())
+    });
+
+    let _ = fs::remove_dir_all(&dir);
+}
+
+criterion_group!(benches, rdc_scan);
+criterion_main!(benches);
@@ -0,0 +1,460 @@
+//! Automatic captures triggered by frame time anomalies.
+
+use std::time::{Duration, Instant};
+
+use crate::renderdoc::RenderDoc;
+use crate::version::V110;
+
+/// Number of histogram buckets per power of two.
+const SUB_BUCKETS: usize = 8;
+/// Number of powers of two covered by the histogram, reaching up to about 4.5 minutes.
+const OCTAVES: usize = 26;
+pub(crate) const NUM_BUCKETS: usize = OCTAVES * SUB_BUCKETS;
+
+/// Rolling frame time statistics, updated in constant time without allocating.
+///
+/// Frame times are recorded into an exponentially weighted moving average (EWMA) and into a
+/// histogram of logarithmically spaced buckets with a relative resolution of about 12%, covering
+/// 1 microsecond to about 4.5 minutes. Percentiles are estimated from the histogram. Once the
+/// histogram holds `window` samples, all bucket counts are halved, so that old frames gradually
+/// lose their influence on the percentiles.
+#[derive(Clone)]
+pub struct FrameTimeStats {
+    ewma_micros: f64,
+    alpha: f64,
+    buckets: [u32; NUM_BUCKETS],
+    count: u32,
+    window: u32,
+    total_frames: u64,
+}
+
+impl FrameTimeStats {
+    /// Creates new statistics with an EWMA smoothing factor of `alpha` and a percentile window of
+    /// roughly `window` frames.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if `alpha` is not within `(0, 1]` or if `window` is zero.
+    pub fn new(alpha: f64, window: u32) -> Self {
+        assert!(alpha > 0.0 && alpha <= 1.0, "EWMA factor must be in (0, 1]");
+        assert!(window > 0, "Percentile window must not be empty");
+
+        FrameTimeStats {
+            ewma_micros: 0.0,
+            alpha,
+            buckets: [0; NUM_BUCKETS],
+            count: 0,
+            window,
+            total_frames: 0,
+        }
+    }
+
+    /// Records the duration of a frame.
+    pub fn record(&mut self, frame_time: Duration) {
+        let micros = duration_as_micros(frame_time);
+
+        if self.total_frames == 0 {
+            self.ewma_micros = micros as f64;
+        } else {
+            self.ewma_micros += self.alpha * (micros as f64 - self.ewma_micros);
+        }
+
+        self.buckets[bucket_index(micros)] += 1;
+        self.count += 1;
+        self.total_frames += 1;
+
+        if self.count >= self.window {
+            self.count = 0;
+            for bucket in self.buckets.iter_mut() {
+                *bucket /= 2;
+                self.count += *bucket;
+            }
+        }
+    }
+
+    /// Returns the total number of frames recorded.
+    pub fn total_frames(&self) -> u64 {
+        self.total_frames
+    }
+
+    /// Returns the exponentially weighted moving average of the frame time.
+    pub fn ewma(&self) -> Duration {
+        Duration::from_nanos((self.ewma_micros * 1000.0) as u64)
+    }
+
+    /// Returns an estimate of the frame time at percentile `p`, which must be within `[0, 100]`.
+    ///
+    /// Returns `None` if no frames have been recorded within the current window.
+    pub fn percentile(&self, p: f64) -> Option<Duration> {
+        if self.count == 0 {
+            return None;
+        }
+
+        let rank = ((p / 100.0) * f64::from(self.count)).ceil().max(1.0) as u32;
+        let mut seen = 0;
+        for (index, &bucket) in self.buckets.iter().enumerate() {
+            seen += bucket;
+            if seen >= rank {
+                return Some(Duration::from_micros(bucket_upper_bound(index)));
+            }
+        }
+
+        Some(Duration::from_micros(bucket_upper_bound(NUM_BUCKETS - 1)))
+    }
+
+    /// Returns the histogram bucket counts of the current window, paired with the upper bound of
+    /// each bucket.
+    pub fn histogram(&self) -> impl Iterator<Item = (Duration, u32)> + '_ {
+        self.buckets
+            .iter()
+            .enumerate()
+            .map(|(index, &count)| (Duration::from_micros(bucket_upper_bound(index)), count))
+    }
+}
+
+impl std::fmt::Debug for FrameTimeStats {
+    fn fmt(&self, fmt: &mut std::fmt::Formatter) -> std::fmt::Result {
+        fmt.debug_struct(stringify!(FrameTimeStats))
+            .field("ewma", &self.ewma())
+            .field("p50", &self.percentile(50.0))
+            .field("p99", &self.percentile(99.0))
+            .field("total_frames", &self.total_frames)
+            .finish()
+    }
+}
+
+impl Default for FrameTimeStats {
+    fn default() -> Self {
+        FrameTimeStats::new(0.05, 4096)
+    }
+}
+
+pub(crate) fn duration_as_micros(d: Duration) -> u64 {
+    d.as_secs() * 1_000_000 + u64::from(d.subsec_micros())
+}
+
+/// Maps a frame time in microseconds to a histogram bucket.
+pub(crate) fn bucket_index(micros: u64) -> usize {
+    if micros < SUB_BUCKETS as u64 {
+        return micros as usize;
+    }
+
+    let octave = 63 - micros.leading_zeros() as usize;
+    let shift = octave - 3;
+    let sub = ((micros >> shift) as usize) & (SUB_BUCKETS - 1);
+    let index = (octave - 2) * SUB_BUCKETS + sub;
+    index.min(NUM_BUCKETS - 1)
+}
+
+/// Returns the largest frame time in microseconds which maps to bucket `index`.
+pub(crate) fn bucket_upper_bound(index: usize) -> u64 {
+    if index < SUB_BUCKETS {
+        return index as u64;
+    }
+
+    let octave = index / SUB_BUCKETS + 2;
+    let sub = (index % SUB_BUCKETS) as u64;
+    let shift = octave - 3;
+    ((SUB_BUCKETS as u64 + sub + 1) << shift) - 1
+}
+
+/// Reason why a frame was considered anomalous.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum AnomalyKind {
+    /// The frame exceeded the absolute frame time budget.
+    OverBudget,
+    /// The frame exceeded the configured multiple of the median frame time.
+    SlowerThanMedian,
+}
+
+/// A frame which triggered an automatic capture.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub struct Anomaly {
+    /// Why the frame was considered anomalous.
+    pub kind: AnomalyKind,
+    /// Duration of the anomalous frame.
+    pub frame_time: Duration,
+    /// Estimated median frame time before the anomalous frame was recorded.
+    pub median: Option<Duration>,
+}
+
+/// Triggers captures automatically when frame times spike.
+///
+/// Every frame time is compared against an absolute budget and against a multiple of the rolling
+/// median before being recorded into [`FrameTimeStats`]. If either limit is exceeded, a capture of
+/// the next `frames_per_capture` frames is triggered with `trigger_capture()` or
+/// `trigger_multi_frame_capture()`. Note that RenderDoc captures the frames _following_ the
+/// anomaly; to capture the anomalous frame itself, see `RollingCapture`.
+///
+/// Since every capture can take hundreds of megabytes on disk, a cooldown is enforced after each
+/// capture and the total number of captures is rate limited with a token bucket, so that a
+/// stutter storm cannot flood the disk.
+///
+/// Updating the statistics and evaluating the triggers takes constant time and never allocates,
+/// so it is suitable for calling from the render thread every frame.
+///
+/// [`FrameTimeStats`]: ./struct.FrameTimeStats.html
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{AnomalyTrigger, Error, RenderDoc, V110};
+/// # use std::time::{Duration, Instant};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V110> = RenderDoc::new()?;
+/// let mut trigger = AnomalyTrigger::new()
+///     .median_multiple(3.0)
+///     .budget(Duration::from_millis(50))
+///     .cooldown(Duration::from_secs(10))
+///     .rate_limit(5, Duration::from_secs(600));
+///
+/// let mut last_frame = Instant::now();
+/// loop {
+///     // Render a frame here...
+///     let now = Instant::now();
+///     if let Some(anomaly) = trigger.on_frame(&mut renderdoc, now - last_frame) {
+///         println!("Captured after {:?}", anomaly);
+///     }
+///     last_frame = now;
+/// #   break;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone, Debug)]
+pub struct AnomalyTrigger {
+    stats: FrameTimeStats,
+    median_multiple: Option<f64>,
+    budget: Option<Duration>,
+    warmup_frames: u64,
+    frames_per_capture: u32,
+    cooldown: Duration,
+    max_captures: u32,
+    rate_window: Duration,
+    tokens: f64,
+    last_refill: Option<Instant>,
+    last_capture: Option<Instant>,
+    captures: u64,
+    suppressed: u64,
+}
+
+impl AnomalyTrigger {
+    /// Creates a new trigger which fires on frames over three times the median frame time.
+    ///
+    /// By default, single frames are captured, the first 120 frames are ignored while the
+    /// statistics warm up, a cooldown of 5 seconds is enforced and at most 10 captures are made
+    /// per hour.
+    pub fn new() -> Self {
+        AnomalyTrigger {
+            stats: FrameTimeStats::default(),
+            median_multiple: Some(3.0),
+            budget: None,
+            warmup_frames: 120,
+            frames_per_capture: 1,
+            cooldown: Duration::from_secs(5),
+            max_captures: 10,
+            rate_window: Duration::from_secs(3600),
+            tokens: 10.0,
+            last_refill: None,
+            last_capture: None,
+            captures: 0,
+            suppressed: 0,
+        }
+    }
+
+    /// Fires on frames which take longer than `multiple` times the rolling median frame time.
+    pub fn median_multiple<M: Into<Option<f64>>>(mut self, multiple: M) -> Self {
+        self.median_multiple = multiple.into();
+        self
+    }
+
+    /// Fires on frames which take longer than the absolute `budget`.
+    pub fn budget<B: Into<Option<Duration>>>(mut self, budget: B) -> Self {
+        self.budget = budget.into();
+        self
+    }
+
+    /// Ignores median-based anomalies during the first `frames` frames.
+    pub fn warmup_frames(mut self, frames: u64) -> Self {
+        self.warmup_frames = frames;
+        self
+    }
+
+    /// Captures `frames` consecutive frames whenever the trigger fires.
+    pub fn frames_per_capture(mut self, frames: u32) -> Self {
+        self.frames_per_capture = frames.max(1);
+        self
+    }
+
+    /// Suppresses the trigger for `cooldown` after every capture.
+    pub fn cooldown(mut self, cooldown: Duration) -> Self {
+        self.cooldown = cooldown;
+        self
+    }
+
+    /// Allows at most `max_captures` captures within any `window` of time.
+    pub fn rate_limit(mut self, max_captures: u32, window: Duration) -> Self {
+        self.max_captures = max_captures;
+        self.rate_window = window;
+        self.tokens = f64::from(max_captures);
+        self
+    }
+
+    /// Replaces the frame time statistics, e.g. to change the EWMA factor or percentile window.
+    pub fn stats(mut self, stats: FrameTimeStats) -> Self {
+        self.stats = stats;
+        self
+    }
+
+    /// Returns the rolling frame time statistics.
+    pub fn frame_stats(&self) -> &FrameTimeStats {
+        &self.stats
+    }
+
+    /// Returns the number of captures triggered so far.
+    pub fn num_captures(&self) -> u64 {
+        self.captures
+    }
+
+    /// Returns the number of anomalies which were not captured due to cooldown or rate limiting.
+    pub fn num_suppressed(&self) -> u64 {
+        self.suppressed
+    }
+
+    /// Records the duration of the frame which just finished, triggering a capture if it was
+    /// anomalous.
+    ///
+    /// Returns the anomaly if a capture was triggered.
+    pub fn on_frame(&mut self, rd: &mut RenderDoc<V110>, frame_time: Duration) -> Option<Anomaly> {
+        let anomaly = self.evaluate(frame_time, Instant::now())?;
+
+        if self.frames_per_capture > 1 {
+            rd.trigger_multi_frame_capture(self.frames_per_capture);
+        } else {
+            rd.trigger_capture();
+        }
+
+        Some(anomaly)
+    }
+
+    /// Records `frame_time` and decides whether a capture should be triggered at `now`.
+    fn evaluate(&mut self, frame_time: Duration, now: Instant) -> Option<Anomaly> {
+        let median = self.stats.percentile(50.0);
+        let warmed_up = self.stats.total_frames() >= self.warmup_frames;
+        self.stats.record(frame_time);
+
+        let kind = if self.budget.map_or(false, |budget| frame_time > budget) {
+            AnomalyKind::OverBudget
+        } else {
+            let limit = match (self.median_multiple, median) {
+                (Some(multiple), Some(median)) if warmed_up => median.as_secs_f64() * multiple,
+                _ => return None,
+            };
+
+            if frame_time.as_secs_f64() > limit {
+                AnomalyKind::SlowerThanMedian
+            } else {
+                return None;
+            }
+        };
+
+        self.refill_tokens(now);
+
+        let cooling_down = self
+            .last_capture
+            .map_or(false, |last| now.duration_since(last) < self.cooldown);
+
+        if cooling_down || self.tokens < 1.0 {
+            self.suppressed += 1;
+            return None;
+        }
+
+        self.tokens -= 1.0;
+        self.last_capture = Some(now);
+        self.captures += 1;
+
+        Some(Anomaly {
+            kind,
+            frame_time,
+            median,
+        })
+    }
+
+    fn refill_tokens(&mut self, now: Instant) {
+        let capacity = f64::from(self.max_captures);
+        if let Some(last) = self.last_refill {
+            let window = self.rate_window.as_secs_f64();
+            let elapsed = now.duration_since(last).as_secs_f64();
+            if window > 0.0 {
+                self.tokens = (self.tokens + elapsed / window * capacity).min(capacity);
+            } else {
+                self.tokens = capacity;
+            }
+        }
+
+        self.last_refill = Some(now);
+    }
+}
+
+impl Default for AnomalyTrigger {
+    fn default() -> Self {
+        AnomalyTrigger::new()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn bucket_bounds_are_monotonic() {
+        for micros in (0..100_000).step_by(7) {
+            let index = bucket_index(micros);
+            assert!(micros <= bucket_upper_bound(index));
+            if index > 0 {
+                assert!(micros > bucket_upper_bound(index - 1));
+            }
+        }
+    }
+
+    #[test]
+    fn percentiles_track_recent_frames() {
+        let mut stats = FrameTimeStats::new(0.1, 1000);
+        for i in 0..1000 {
+            let micros = if i % 100 == 0 { 50_000 } else { 16_000 };
+            stats.record(Duration::from_micros(micros));
+        }
+
+        let p50 = stats.percentile(50.0).unwrap();
+        assert!(p50 >= Duration::from_micros(16_000) && p50 < Duration::from_micros(18_000));
+
+        let p999 = stats.percentile(99.9).unwrap();
+        assert!(p999 >= Duration::from_micros(50_000));
+    }
+
+    #[test]
+    fn cooldown_and_rate_limit_suppress_storms() {
+        let mut trigger = AnomalyTrigger::new()
+            .warmup_frames(10)
+            .cooldown(Duration::from_secs(1))
+            .rate_limit(2, Duration::from_secs(60));
+
+        let start = Instant::now();
+        for i in 0..10 {
+            let now = start + Duration::from_millis(i * 16);
+            assert!(trigger.evaluate(Duration::from_millis(16), now).is_none());
+        }
+
+        let spike = Duration::from_millis(100);
+        assert!(trigger.evaluate(spike, start).is_some());
+        assert!(trigger.evaluate(spike, start).is_none());
+
+        let later = start + Duration::from_secs(2);
+        assert!(trigger.evaluate(spike, later).is_some());
+
+        let even_later = start + Duration::from_secs(4);
+        assert!(trigger.evaluate(spike, even_later).is_none());
+        assert_eq!(trigger.num_captures(), 2);
+        assert_eq!(trigger.num_suppressed(), 2);
+    }
+}
@@ -0,0 +1,235 @@
+//! Implementations of the calls `RenderDoc<V>` makes into the RenderDoc API.
+
+use std::hash::Hash;
+use std::os::raw::{c_char, c_int, c_void};
+use std::ptr;
+
+use crate::function_table::FunctionTable;
+use crate::version::Entry;
+
+type DevicePointer = *mut c_void;
+type WindowHandle = *mut c_void;
+
+/// Backend selected at compile time for every `RenderDoc<V>`.
+///
+/// With the `disabled` feature enabled, this is a zero-sized type whose calls all compile to
+/// nothing, and the RenderDoc library is never loaded.
+#[cfg(not(feature = "disabled"))]
+pub(crate) type Active = FunctionTable;
+
+/// Backend selected at compile time for every `RenderDoc<V>`.
+///
+/// With the `disabled` feature enabled, this is a zero-sized type whose calls all compile to
+/// nothing, and the RenderDoc library is never loaded.
+#[cfg(feature = "disabled")]
+pub(crate) type Active = Disabled;
+
+/// Calls into the RenderDoc API, with the same signatures as the raw API functions.
+pub(crate) trait Backend: Copy + Eq + Hash {
+    /// Returns a backend on which every call does nothing.
+    fn disabled() -> Self;
+
+    /// Returns the raw entry point, or null if the backend is disabled.
+    fn entry(&self) -> *mut Entry;
+
+    unsafe fn get_api_version(&self, major: *mut c_int, minor: *mut c_int, patch: *mut c_int);
+    unsafe fn set_capture_option_u32(&self, opt: u32, val: u32) -> c_int;
+    unsafe fn set_capture_option_f32(&self, opt: u32, val: f32) -> c_int;
+    unsafe fn get_capture_option_u32(&self, opt: u32) -> u32;
+    unsafe fn get_capture_option_f32(&self, opt: u32) -> f32;
+    unsafe fn set_focus_toggle_keys(&self, keys: *mut u32, num: c_int);
+    unsafe fn set_capture_keys(&self, keys: *mut u32, num: c_int);
+    unsafe fn get_overlay_bits(&self) -> u32;
+    unsafe fn mask_overlay_bits(&self, and: u32, or: u32);
+    unsafe fn remove_hooks(&self);
+    unsafe fn unload_crash_handler(&self);
+    unsafe fn set_capture_file_path_template(&self, template: *const c_char);
+    unsafe fn get_capture_file_path_template(&self) -> *const c_char;
+    unsafe fn get_num_captures(&self) -> u32;
+    unsafe fn get_capture(&self, idx: u32, path: *mut c_char, len: *mut u32, time: *mut u64)
+        -> u32;
+    unsafe fn trigger_capture(&self);
+    unsafe fn is_target_control_connected(&self) -> u32;
+    unsafe fn launch_replay_ui(&self, connect: u32, cmdline: *const c_char) -> u32;
+    unsafe fn set_active_window(&self, dev: DevicePointer, win: WindowHandle);
+    unsafe fn start_frame_capture(&self, dev: DevicePointer, win: WindowHandle);
+    unsafe fn is_frame_capturing(&self) -> u32;
+    unsafe fn end_frame_capture(&self, dev: DevicePointer, win: WindowHandle) -> u32;
+    unsafe fn trigger_multi_frame_capture(&self, num_frames: u32);
+    unsafe fn set_capture_file_comments(&self, path: *const c_char, comments: *const c_char);
+    unsafe fn discard_frame_capture(&self, dev: DevicePointer, win: WindowHandle) -> u32;
+}
+
+/// Forwards each backend call to the function pointer of the same name.
+macro_rules! forward {
+    ($($name:ident($($arg:ident: $ty:ty),*) $(-> $ret:ty)?;)+) => {
+        $(
+            #[inline]
+            unsafe fn $name(&self, $($arg: $ty),*) $(-> $ret)? {
+                (self.$name)($($arg),*)
+            }
+        )+
+    };
+}
+
+impl Backend for FunctionTable {
+    fn disabled() -> Self {
+        FunctionTable::stubbed()
+    }
+
+    #[inline]
+    fn entry(&self) -> *mut Entry {
+        self.entry
+    }
+
+    forward! {
+        get_api_version(major: *mut c_int, minor: *mut c_int, patch: *mut c_int);
+        set_capture_option_u32(opt: u32, val: u32) -> c_int;
+        set_capture_option_f32(opt: u32, val: f32) -> c_int;
+        get_capture_option_u32(opt: u32) -> u32;
+        get_capture_option_f32(opt: u32) -> f32;
+        set_focus_toggle_keys(keys: *mut u32, num: c_int);
+        set_capture_keys(keys: *mut u32, num: c_int);
+        get_overlay_bits() -> u32;
+        mask_overlay_bits(and: u32, or: u32);
+        remove_hooks();
+        unload_crash_handler();
+        set_capture_file_path_template(template: *const c_char);
+        get_capture_file_path_template() -> *const c_char;
+        get_num_captures() -> u32;
+        get_capture(idx: u32, path: *mut c_char, len: *mut u32, time: *mut u64) -> u32;
+        trigger_capture();
+        is_target_control_connected() -> u32;
+        launch_replay_ui(connect: u32, cmdline: *const c_char) -> u32;
+        set_active_window(dev: DevicePointer, win: WindowHandle);
+        start_frame_capture(dev: DevicePointer, win: WindowHandle);
+        is_frame_capturing() -> u32;
+        end_frame_capture(dev: DevicePointer, win: WindowHandle) -> u32;
+        trigger_multi_frame_capture(num_frames: u32);
+        set_capture_file_comments(path: *const c_char, comments: *const c_char);
+        discard_frame_capture(dev: DevicePointer, win: WindowHandle) -> u32;
+    }
+}
+
+/// Backend which does nothing, selected at compile time by the `disabled` feature.
+///
+/// Setters report success and getters return the same values as `FunctionTable::stubbed()`.
+#[cfg_attr(not(feature = "disabled"), allow(dead_code))]
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub(crate) struct Disabled;
+
+#[allow(unused_variables)]
+impl Backend for Disabled {
+    #[inline(always)]
+    fn disabled() -> Self {
+        Disabled
+    }
+
+    #[inline(always)]
+    fn entry(&self) -> *mut Entry {
+        ptr::null_mut()
+    }
+
+    #[inline(always)]
+    unsafe fn get_api_version(&self, major: *mut c_int, minor: *mut c_int, patch: *mut c_int) {}
+    #[inline(always)]
+    unsafe fn set_capture_option_u32(&self, opt: u32, val: u32) -> c_int {
+        1
+    }
+    #[inline(always)]
+    unsafe fn set_capture_option_f32(&self, opt: u32, val: f32) -> c_int {
+        1
+    }
+    #[inline(always)]
+    unsafe fn get_capture_option_u32(&self, opt: u32) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn get_capture_option_f32(&self, opt: u32) -> f32 {
+        0.0
+    }
+    #[inline(always)]
+    unsafe fn set_focus_toggle_keys(&self, keys: *mut u32, num: c_int) {}
+    #[inline(always)]
+    unsafe fn set_capture_keys(&self, keys: *mut u32, num: c_int) {}
+    #[inline(always)]
+    unsafe fn get_overlay_bits(&self) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn mask_overlay_bits(&self, and: u32, or: u32) {}
+    #[inline(always)]
+    unsafe fn remove_hooks(&self) {}
+    #[inline(always)]
+    unsafe fn unload_crash_handler(&self) {}
+    #[inline(always)]
+    unsafe fn set_capture_file_path_template(&self, template: *const c_char) {}
+    #[inline(always)]
+    unsafe fn get_capture_file_path_template(&self) -> *const c_char {
+        b"\0".as_ptr() as *const c_char
+    }
+    #[inline(always)]
+    unsafe fn get_num_captures(&self) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn get_capture(&self, i: u32, p: *mut c_char, l: *mut u32, t: *mut u64) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn trigger_capture(&self) {}
+    #[inline(always)]
+    unsafe fn is_target_control_connected(&self) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn launch_replay_ui(&self, connect: u32, cmdline: *const c_char) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn set_active_window(&self, dev: DevicePointer, win: WindowHandle) {}
+    #[inline(always)]
+    unsafe fn start_frame_capture(&self, dev: DevicePointer, win: WindowHandle) {}
+    #[inline(always)]
+    unsafe fn is_frame_capturing(&self) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn end_frame_capture(&self, dev: DevicePointer, win: WindowHandle) -> u32 {
+        0
+    }
+    #[inline(always)]
+    unsafe fn trigger_multi_frame_capture(&self, num_frames: u32) {}
+    #[inline(always)]
+    unsafe fn set_capture_file_comments(&self, path: *const c_char, comments: *const c_char) {}
+    #[inline(always)]
+    unsafe fn discard_frame_capture(&self, dev: DevicePointer, win: WindowHandle) -> u32 {
+        0
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::renderdoc::RenderDoc;
+    use crate::version::V141;
+
+    #[test]
+    #[cfg(feature = "disabled")]
+    fn disabled_handle_is_zero_sized() {
+        assert_eq!(std::mem::size_of::<RenderDoc<V141>>(), 0);
+        assert!(RenderDoc::<V141>::new().unwrap().is_disabled());
+    }
+
+    #[test]
+    fn disabled_handle_does_nothing() {
+        let mut renderdoc = RenderDoc::<V141>::disabled();
+        assert!(renderdoc.is_disabled());
+
+        renderdoc.start_frame_capture(ptr::null(), ptr::null());
+        assert!(!renderdoc.is_frame_capturing());
+        renderdoc.end_frame_capture(ptr::null(), ptr::null());
+        assert_eq!(renderdoc.get_num_captures(), 0);
+        assert_eq!(renderdoc.get_capture(0), None);
+    }
+}
@@ -0,0 +1,214 @@
+//! Enumeration of completed frame captures.
+
+use std::iter::FusedIterator;
+use std::path::PathBuf;
+use std::time::SystemTime;
+
+use crate::renderdoc::RenderDoc;
+use crate::version::V100;
+
+/// An iterator over the paths and capture times of all captures made so far.
+///
+/// This `struct` is created by the [`captures()`] method on `RenderDoc`. The number of captures
+/// is sampled once upon creation, so captures completing during iteration are not included.
+/// Captures which can no longer be retrieved are skipped.
+///
+/// [`captures()`]: ./struct.RenderDoc.html#method.captures
+#[derive(Debug)]
+pub struct Captures<'a> {
+    renderdoc: &'a RenderDoc<V100>,
+    index: u32,
+    end: u32,
+}
+
+impl<'a> Captures<'a> {
+    pub(crate) fn new(renderdoc: &'a RenderDoc<V100>) -> Self {
+        Captures {
+            renderdoc,
+            index: 0,
+            end: renderdoc.get_num_captures(),
+        }
+    }
+}
+
+impl<'a> Iterator for Captures<'a> {
+    type Item = (PathBuf, SystemTime);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        while self.index < self.end {
+            let capture = self.renderdoc.get_capture(self.index);
+            self.index += 1;
+            if capture.is_some() {
+                return capture;
+            }
+        }
+
+        None
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let remaining = (self.end - self.index) as usize;
+        (0, Some(remaining))
+    }
+}
+
+impl<'a> FusedIterator for Captures<'a> {}
+
+/// Incrementally detects new captures between polls.
+///
+/// RenderDoc only ever appends to its list of captures, so the watcher remembers the index of the
+/// last capture it has reported and only retrieves the ones made after it. Polling costs a single
+/// call to `get_num_captures()` and never allocates when no new captures have been made, which
+/// makes it cheap enough to call once per frame.
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureWatcher, Error, RenderDoc, V100};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V100> = RenderDoc::new()?;
+/// let mut watcher = CaptureWatcher::new();
+///
+/// loop {
+///     // Render a frame here...
+///
+///     for (path, capture_time) in watcher.poll(&renderdoc) {
+///         println!("New capture: {} at {:?}", path.display(), capture_time);
+///     }
+/// #   break;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone, Debug, Default, Eq, Hash, PartialEq)]
+pub struct CaptureWatcher {
+    next: u32,
+}
+
+impl CaptureWatcher {
+    /// Creates a new `CaptureWatcher` which reports every capture, including existing ones.
+    pub fn new() -> Self {
+        CaptureWatcher::default()
+    }
+
+    /// Creates a new `CaptureWatcher` which only reports captures made from this point onward.
+    pub fn skip_existing(renderdoc: &RenderDoc<V100>) -> Self {
+        CaptureWatcher {
+            next: renderdoc.get_num_captures(),
+        }
+    }
+
+    /// Returns the number of captures which have been reported so far.
+    pub fn num_seen(&self) -> u32 {
+        self.next
+    }
+
+    /// Returns whether any captures have been made since the last poll.
+    pub fn has_new(&self, renderdoc: &RenderDoc<V100>) -> bool {
+        renderdoc.get_num_captures() > self.next
+    }
+
+    /// Returns an iterator over the captures made since the previous poll.
+    ///
+    /// Captures are marked as seen as they are yielded, so any captures left unconsumed when the
+    /// iterator is dropped will be reported again by the next poll.
+    pub fn poll<'a>(&'a mut self, renderdoc: &'a RenderDoc<V100>) -> NewCaptures<'a> {
+        let end = renderdoc.get_num_captures();
+        NewCaptures {
+            watcher: self,
+            renderdoc,
+            end,
+        }
+    }
+}
+
+/// An iterator over the captures made since the previous poll of a `CaptureWatcher`.
+///
+/// This `struct` is created by the [`poll()`] method on `CaptureWatcher`.
+///
+/// [`poll()`]: ./struct.CaptureWatcher.html#method.poll
+#[derive(Debug)]
+pub struct NewCaptures<'a> {
+    watcher: &'a mut CaptureWatcher,
+    renderdoc: &'a RenderDoc<V100>,
+    end: u32,
+}
+
+impl<'a> NewCaptures<'a> {
+    /// Retrieves the next new capture, writing its path into the existing `path` buffer.
+    ///
+    /// This is the allocation-free counterpart to `next()`; see `get_capture_into()`.
+    pub fn next_into(&mut self, path: &mut PathBuf) -> Option<SystemTime> {
+        if self.watcher.next >= self.end {
+            return None;
+        }
+
+        let capture_time = self.renderdoc.get_capture_into(self.watcher.next, path)?;
+        self.watcher.next += 1;
+        Some(capture_time)
+    }
+}
+
+impl<'a> Iterator for NewCaptures<'a> {
+    type Item = (PathBuf, SystemTime);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let mut path = PathBuf::new();
+        self.next_into(&mut path)
+            .map(|capture_time| (path, capture_time))
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let remaining = self.end.saturating_sub(self.watcher.next) as usize;
+        (0, Some(remaining))
+    }
+}
+
+#[cfg(test)]
+#[cfg(all(feature = "mock", not(feature = "disabled")))]
+mod tests {
+    use super::*;
+    use crate::mock;
+    use crate::version::V141;
+
+    #[test]
+    fn captures_and_watcher_report_each_capture_once() {
+        let _lock = mock::lock_for_test();
+        mock::reset();
+        let mut rd = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+        let path = |rd: &RenderDoc<V141>, index| rd.get_capture(index).unwrap().0;
+
+        let mut watcher = CaptureWatcher::new();
+        assert!(!watcher.has_new(&rd));
+        rd.trigger_capture();
+        rd.trigger_capture();
+        assert!(watcher.has_new(&rd));
+
+        let paths: Vec<PathBuf> = rd.captures().map(|(path, _)| path).collect();
+        assert_eq!(paths, vec![path(&rd, 0), path(&rd, 1)]);
+
+        // Captures left unconsumed are reported again by the next poll.
+        assert_eq!(watcher.poll(&rd).next().unwrap().0, path(&rd, 0));
+        rd.trigger_capture();
+        let mut buf = PathBuf::new();
+        let mut new = watcher.poll(&rd);
+        assert!(new.next_into(&mut buf).is_some());
+        assert_eq!(buf, path(&rd, 1));
+        assert_eq!(new.next().unwrap().0, path(&rd, 2));
+        assert!(new.next().is_none());
+        assert_eq!(watcher.num_seen(), 3);
+        assert!(!watcher.has_new(&rd));
+        assert_eq!(CaptureWatcher::skip_existing(&rd).num_seen(), 3);
+
+        // Captures which disappear during iteration are skipped without ending it early.
+        let first = path(&rd, 0);
+        let mut other = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+        let mut captures = rd.captures();
+        assert_eq!(captures.next().unwrap().0, first);
+        mock::reset();
+        other.trigger_capture();
+        assert!(captures.next().is_none());
+        assert!(captures.next().is_none());
+        mock::reset();
+    }
+}
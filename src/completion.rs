@@ -0,0 +1,897 @@
+//! Notification of captures as soon as RenderDoc has finished writing them to disk.
+
+use std::cmp;
+use std::collections::VecDeque;
+use std::ffi::{OsStr, OsString};
+use std::fs;
+use std::future::Future;
+use std::mem;
+use std::path::{Path, PathBuf};
+use std::pin::Pin;
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Condvar, Mutex, MutexGuard};
+use std::task::{Context, Poll, Waker};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant, SystemTime};
+
+use crate::error::Error;
+use crate::renderdoc::RenderDoc;
+use crate::version::{V100, V110};
+
+/// How long a written file may go without a matching entry in the capture list before it is
+/// reported on its own.
+const MATCH_TIMEOUT: Duration = Duration::from_millis(250);
+
+/// How often the capture list is checked again while a written file is waiting for its entry.
+const MATCH_RETRY: Duration = Duration::from_millis(5);
+
+/// Number of listed captures remembered while waiting for their file to be written.
+const MAX_UNWRITTEN: usize = 64;
+
+/// A capture file which RenderDoc has finished writing.
+///
+/// On platforms other than Linux, this is inferred from the size of the file no longer changing,
+/// see `CompletionWatcher`.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct CompletedCapture {
+    path: PathBuf,
+    capture_time: SystemTime,
+    index: Option<u32>,
+}
+
+impl CompletedCapture {
+    /// Returns the path of the capture file.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// Returns the time at which the capture was made.
+    ///
+    /// For captures without an `index()`, this is the modification time of the file instead.
+    pub fn capture_time(&self) -> SystemTime {
+        self.capture_time
+    }
+
+    /// Returns the index of the capture for use with `get_capture()`.
+    ///
+    /// This is `None` if the file was not found in the capture list of this process, such as
+    /// captures written by another process sharing the same path template.
+    pub fn index(&self) -> Option<u32> {
+        self.index
+    }
+}
+
+/// Reports captures the moment RenderDoc has finished writing them, without polling the capture
+/// list from the frame loop.
+///
+/// A background thread watches the directory of the capture file path template for capture files
+/// being closed after writing, and matches each one to its entry in the capture list. Completed
+/// captures are then delivered to every channel returned by [`subscribe()`].
+///
+/// On Linux, the directory is watched with inotify, so captures are reported once RenderDoc has
+/// closed their file. On other platforms, the thread polls the capture list at a fixed interval
+/// instead, which still keeps the polling off the frame loop. There, a capture is reported once its
+/// file has the same non-zero size on two consecutive polls, so a capture whose writing stalls for
+/// longer than the interval may be reported before it is complete.
+///
+/// Captures can also be awaited with [`capture_next_frame()`] and [`capture_frames()`], which
+/// trigger a capture and return a future resolving once all of its files have been written.
+///
+/// The path template is read once when the watcher is created, so captures saved after changing
+/// it are not reported.
+///
+/// [`subscribe()`]: #method.subscribe
+/// [`capture_next_frame()`]: #method.capture_next_frame
+/// [`capture_frames()`]: #method.capture_frames
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CompletionWatcher, Error, RenderDoc, V141};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// let watcher = CompletionWatcher::new(&renderdoc)?;
+/// let completed = watcher.subscribe();
+///
+/// renderdoc.trigger_capture();
+/// // Render the frame to be captured here...
+///
+/// // Elsewhere, possibly on another thread:
+/// for capture in completed.iter() {
+///     println!("Finished writing {}", capture.path().display());
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct CompletionWatcher {
+    subscribers: Arc<Mutex<Vec<Subscriber>>>,
+    interrupt: sys::Interrupt,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl CompletionWatcher {
+    /// Starts watching for captures saved with the current capture file path template.
+    ///
+    /// Only captures made after this call are reported.
+    pub fn new(renderdoc: &RenderDoc<V100>) -> Result<Self, Error> {
+        let template = renderdoc.get_log_file_path_template().to_owned();
+        CompletionWatcher::with_path_template(renderdoc, template)
+    }
+
+    /// Starts watching for captures saved with the given capture file path template.
+    ///
+    /// This is useful when the template is about to be changed. The directory of the template is
+    /// created if it does not exist yet. Only captures made after this call are reported.
+    pub fn with_path_template<P>(renderdoc: &RenderDoc<V100>, template: P) -> Result<Self, Error>
+    where
+        P: AsRef<Path>,
+    {
+        let template = template.as_ref();
+        let dir = match template.parent() {
+            Some(dir) if !dir.as_os_str().is_empty() => dir.to_owned(),
+            _ => PathBuf::from("."),
+        };
+
+        let prefix = template.file_name().map(OsStr::to_owned);
+        fs::create_dir_all(&dir).map_err(Error::watch)?;
+        let (source, interrupt) = sys::Source::new(&dir).map_err(Error::watch)?;
+
+        let subscribers = Arc::new(Mutex::new(Vec::new()));
+        let mut matcher = Matcher {
+            // NOTE: The watcher thread only calls `GetNumCaptures` and `GetCapture`. RenderDoc
+            // reads its capture list from its own target control thread as well, so the list is
+            // guarded by a lock inside RenderDoc and both calls are safe from any thread.
+            renderdoc: renderdoc.duplicate(),
+            dir,
+            prefix,
+            next: renderdoc.get_num_captures(),
+            unwritten: VecDeque::new(),
+            written: Vec::new(),
+            subscribers: subscribers.clone(),
+        };
+
+        let thread = thread::Builder::new()
+            .name("renderdoc-completion".into())
+            .spawn(move || {
+                matcher.run(source);
+                matcher.close();
+            })
+            .map_err(Error::watch)?;
+
+        Ok(CompletionWatcher {
+            subscribers,
+            interrupt,
+            thread: Some(thread),
+        })
+    }
+
+    /// Returns a channel receiving every capture completed from now on.
+    ///
+    /// Each subscriber receives its own copy of every event. Dropping the receiver unsubscribes.
+    pub fn subscribe(&self) -> Receiver<CompletedCapture> {
+        let (sender, receiver) = mpsc::channel();
+        let subscriber = Subscriber::Channel(sender);
+        self.subscribers.lock().unwrap().push(subscriber);
+        receiver
+    }
+
+    /// Captures the next frame, returning a future which resolves once the capture is written.
+    ///
+    /// The future can be awaited on any executor, or waited on with [`CaptureFuture::wait()`].
+    ///
+    /// [`CaptureFuture::wait()`]: ./struct.CaptureFuture.html#method.wait
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{CompletionWatcher, Error, RenderDoc, V141};
+    /// # async fn example() -> Result<(), Error> {
+    /// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+    /// let watcher = CompletionWatcher::new(&renderdoc)?;
+    ///
+    /// let capture = watcher.capture_next_frame(&mut renderdoc);
+    /// // Keep rendering frames elsewhere...
+    /// for (path, capture_time) in capture.await {
+    ///     println!("Captured {} at {:?}", path.display(), capture_time);
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn capture_next_frame(&self, renderdoc: &mut RenderDoc<V100>) -> CaptureFuture {
+        let future = self.expect_captures(renderdoc, 1);
+        renderdoc.trigger_capture();
+        future
+    }
+
+    /// Captures the next `num_frames` frames, returning a future which resolves once every
+    /// capture has been written.
+    ///
+    /// RenderDoc saves each frame to a separate capture file.
+    pub fn capture_frames(
+        &self,
+        renderdoc: &mut RenderDoc<V110>,
+        num_frames: u32,
+    ) -> CaptureFuture {
+        let future = self.expect_captures(renderdoc, num_frames);
+        renderdoc.trigger_multi_frame_capture(num_frames);
+        future
+    }
+
+    /// Returns a future for the next `count` captures made after the current ones.
+    ///
+    /// The future is registered before the capture is triggered, so no completion can be missed.
+    /// Each future reserves its own range of capture indices after those reserved by the futures
+    /// which are still outstanding, so dropped and finished futures release their range.
+    fn expect_captures(&self, renderdoc: &RenderDoc<V100>, count: u32) -> CaptureFuture {
+        let mut subscribers = self.subscribers.lock().unwrap();
+        let reserved = subscribers
+            .iter()
+            .filter_map(Subscriber::reserved_end)
+            .max()
+            .unwrap_or(0);
+        let first_index = cmp::max(renderdoc.get_num_captures(), reserved);
+
+        let slot = Arc::new(FrameSlot {
+            state: Mutex::new(FrameState {
+                captures: Vec::with_capacity(count as usize),
+                remaining: count,
+                first_index,
+                end_index: first_index.saturating_add(count),
+                closed: false,
+                waker: None,
+            }),
+            ready: Condvar::new(),
+        });
+
+        if count > 0 {
+            subscribers.push(Subscriber::Future(slot.clone()));
+        }
+
+        CaptureFuture { slot }
+    }
+}
+
+impl Drop for CompletionWatcher {
+    fn drop(&mut self) {
+        self.interrupt.interrupt();
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// A capture in the capture list whose file has not been reported as written yet.
+struct Listed {
+    name: OsString,
+    index: u32,
+    capture_time: SystemTime,
+    /// Size of the file when last polled, on platforms without file events.
+    size: u64,
+}
+
+/// State of the watcher thread, pairing written files with entries in the capture list.
+struct Matcher {
+    renderdoc: RenderDoc<V100>,
+    dir: PathBuf,
+    prefix: Option<OsString>,
+    next: u32,
+    unwritten: VecDeque<Listed>,
+    /// Written files which have not appeared in the capture list yet.
+    written: Vec<(OsString, Instant)>,
+    subscribers: Arc<Mutex<Vec<Subscriber>>>,
+}
+
+impl Matcher {
+    fn run(&mut self, mut source: sys::Source) {
+        let mut names = Vec::new();
+        loop {
+            let timeout = if self.written.is_empty() {
+                sys::IDLE_TIMEOUT
+            } else {
+                Some(MATCH_RETRY)
+            };
+
+            names.clear();
+            let overflowed = match source.wait(timeout, &mut names) {
+                Ok(sys::Wait::Events) => false,
+                Ok(sys::Wait::Overflow) => true,
+                Ok(sys::Wait::Interrupted) | Err(_) => return,
+            };
+
+            let now = Instant::now();
+            for name in names.drain(..) {
+                if self.is_capture(&name) {
+                    self.written.push((name, now));
+                }
+            }
+
+            self.update_list();
+            self.match_written(now);
+
+            if !sys::WATCHES_FILES {
+                self.match_settled();
+            } else if overflowed {
+                // Files closed while events were dropped are never reported, so assume every
+                // listed capture has been written.
+                while let Some(listed) = self.unwritten.pop_front() {
+                    self.publish(listed.name, listed.capture_time, Some(listed.index));
+                }
+            }
+        }
+    }
+
+    fn is_capture(&self, name: &OsStr) -> bool {
+        let name = Path::new(name);
+        let starts_with_prefix = match self.prefix {
+            Some(ref prefix) => name
+                .to_string_lossy()
+                .starts_with(&*prefix.to_string_lossy()),
+            None => true,
+        };
+
+        starts_with_prefix && name.extension() == Some(OsStr::new("rdc"))
+    }
+
+    /// Remembers the captures added to the list since the previous update.
+    fn update_list(&mut self) {
+        let mut path = PathBuf::new();
+        let end = self.renderdoc.get_num_captures();
+        while self.next < end {
+            if let Some(capture_time) = self.renderdoc.get_capture_into(self.next, &mut path) {
+                if let Some(name) = path.file_name() {
+                    if self.unwritten.len() == MAX_UNWRITTEN {
+                        self.unwritten.pop_front();
+                    }
+
+                    self.unwritten.push_back(Listed {
+                        name: name.to_owned(),
+                        index: self.next,
+                        capture_time,
+                        size: 0,
+                    });
+                }
+            }
+
+            self.next += 1;
+        }
+    }
+
+    /// Reports written files found in the capture list, and those which waited too long for it.
+    fn match_written(&mut self, now: Instant) {
+        let mut i = 0;
+        while i < self.written.len() {
+            let listed = {
+                let name = &self.written[i].0;
+                self.unwritten
+                    .iter()
+                    .position(|listed| listed.name == *name)
+            };
+
+            if let Some(pos) = listed {
+                let listed = self.unwritten.remove(pos).unwrap();
+                self.written.remove(i);
+                self.publish(listed.name, listed.capture_time, Some(listed.index));
+            } else if now.duration_since(self.written[i].1) >= MATCH_TIMEOUT {
+                let (name, _) = self.written.remove(i);
+                let capture_time = fs::metadata(self.dir.join(&name))
+                    .and_then(|meta| meta.modified())
+                    .unwrap_or_else(|_| SystemTime::now());
+                self.publish(name, capture_time, None);
+            } else {
+                i += 1;
+            }
+        }
+    }
+
+    /// Reports listed captures whose file size has stopped changing since the previous poll, for
+    /// platforms without file events.
+    fn match_settled(&mut self) {
+        let mut i = 0;
+        while i < self.unwritten.len() {
+            let listed = &mut self.unwritten[i];
+            let size = fs::metadata(self.dir.join(&listed.name)).map_or(0, |meta| meta.len());
+            if size == 0 || size != listed.size {
+                listed.size = size;
+                i += 1;
+                continue;
+            }
+
+            let listed = self.unwritten.remove(i).unwrap();
+            self.publish(listed.name, listed.capture_time, Some(listed.index));
+        }
+    }
+
+    fn publish(&self, name: OsString, capture_time: SystemTime, index: Option<u32>) {
+        let capture = CompletedCapture {
+            path: self.dir.join(name),
+            capture_time,
+            index,
+        };
+
+        let mut subscribers = self.subscribers.lock().unwrap();
+        subscribers.retain(|subscriber| subscriber.deliver(&capture));
+    }
+
+    /// Resolves every outstanding future with the captures it has received so far.
+    fn close(&self) {
+        for subscriber in self.subscribers.lock().unwrap().drain(..) {
+            if let Subscriber::Future(slot) = subscriber {
+                let mut state = slot.state.lock().unwrap();
+                state.closed = true;
+                slot.notify(state);
+            }
+        }
+    }
+}
+
+/// Frame captures requested from a `CompletionWatcher`, which resolve once they are written.
+///
+/// This can either be awaited as a `Future` on any executor, or waited on with [`wait()`]. Both
+/// yield the path and capture time of every requested capture, in the order they were written.
+/// If the watcher is dropped first, the captures written until then are returned.
+///
+/// Each request reserves the range of capture indices following the current captures and the
+/// ranges of every other outstanding request, and only accepts captures within it. Dropping the
+/// future releases its range. A capture triggered by other means between the reservation and the
+/// trigger takes an index within the range, and is returned in place of a requested one. If a
+/// trigger never produces a capture, the future stays pending until it or the watcher is dropped.
+///
+/// [`wait()`]: #method.wait
+#[derive(Debug)]
+pub struct CaptureFuture {
+    slot: Arc<FrameSlot>,
+}
+
+impl CaptureFuture {
+    /// Returns whether every requested capture has been written.
+    pub fn is_finished(&self) -> bool {
+        self.slot.state.lock().unwrap().is_finished()
+    }
+
+    /// Blocks the current thread until every requested capture has been written.
+    pub fn wait(self) -> Vec<(PathBuf, SystemTime)> {
+        let mut state = self.slot.state.lock().unwrap();
+        while !state.is_finished() {
+            state = self.slot.ready.wait(state).unwrap();
+        }
+
+        mem::replace(&mut state.captures, Vec::new())
+    }
+}
+
+impl Future for CaptureFuture {
+    type Output = Vec<(PathBuf, SystemTime)>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let mut state = self.slot.state.lock().unwrap();
+        if state.is_finished() {
+            return Poll::Ready(mem::replace(&mut state.captures, Vec::new()));
+        }
+
+        let stale = state
+            .waker
+            .as_ref()
+            .map_or(true, |w| !w.will_wake(cx.waker()));
+        if stale {
+            state.waker = Some(cx.waker().clone());
+        }
+        Poll::Pending
+    }
+}
+
+/// Destination of completed captures.
+#[derive(Debug)]
+enum Subscriber {
+    Channel(Sender<CompletedCapture>),
+    Future(Arc<FrameSlot>),
+}
+
+impl Subscriber {
+    /// Returns the end of the capture index range reserved by an outstanding future.
+    fn reserved_end(&self) -> Option<u32> {
+        match *self {
+            Subscriber::Channel(_) => None,
+            Subscriber::Future(ref slot) => {
+                if Arc::strong_count(slot) == 1 {
+                    return None;
+                }
+
+                let state = slot.state.lock().unwrap();
+                if state.is_finished() {
+                    None
+                } else {
+                    Some(state.end_index)
+                }
+            }
+        }
+    }
+
+    /// Delivers `capture`, returning whether the subscriber still wants further captures.
+    ///
+    /// Every channel receives the capture, but a future only accepts captures in its reserved
+    /// index range. Captures missing from the capture list never resolve a future.
+    fn deliver(&self, capture: &CompletedCapture) -> bool {
+        match *self {
+            Subscriber::Channel(ref sender) => sender.send(capture.clone()).is_ok(),
+            Subscriber::Future(ref slot) => {
+                // NOTE: The future has been dropped if the watcher holds the only reference.
+                if Arc::strong_count(slot) == 1 {
+                    return false;
+                }
+
+                let mut state = slot.state.lock().unwrap();
+                let requested = capture.index.map_or(false, |index| {
+                    index >= state.first_index && index < state.end_index
+                });
+                if !requested {
+                    return true;
+                }
+
+                state
+                    .captures
+                    .push((capture.path.clone(), capture.capture_time));
+                state.remaining -= 1;
+                if state.remaining > 0 {
+                    return true;
+                }
+
+                slot.notify(state);
+                false
+            }
+        }
+    }
+}
+
+#[derive(Debug)]
+struct FrameSlot {
+    state: Mutex<FrameState>,
+    ready: Condvar,
+}
+
+impl FrameSlot {
+    /// Wakes up whoever is waiting on `state`, releasing the lock first.
+    fn notify(&self, mut state: MutexGuard<'_, FrameState>) {
+        let waker = state.waker.take();
+        drop(state);
+
+        self.ready.notify_all();
+        if let Some(waker) = waker {
+            waker.wake();
+        }
+    }
+}
+
+#[derive(Debug)]
+struct FrameState {
+    captures: Vec<(PathBuf, SystemTime)>,
+    remaining: u32,
+    /// Index of the first capture made after the request.
+    first_index: u32,
+    /// Index after the last capture requested.
+    end_index: u32,
+    closed: bool,
+    waker: Option<Waker>,
+}
+
+impl FrameState {
+    fn is_finished(&self) -> bool {
+        self.remaining == 0 || self.closed
+    }
+}
+
+#[cfg(target_os = "linux")]
+mod sys {
+    use std::ffi::OsString;
+    use std::io;
+    use std::mem;
+    use std::os::unix::ffi::OsStringExt;
+    use std::os::unix::io::RawFd;
+    use std::path::Path;
+    use std::ptr;
+    use std::time::Duration;
+
+    use crate::marshal::with_c_str;
+
+    /// The watcher thread only wakes up for events.
+    pub const IDLE_TIMEOUT: Option<Duration> = None;
+
+    /// Whether `Source` reports individual files being written.
+    pub const WATCHES_FILES: bool = true;
+
+    /// Outcome of waiting for filesystem events.
+    pub enum Wait {
+        Events,
+        Overflow,
+        Interrupted,
+    }
+
+    /// An inotify instance watching a single directory for files closed after writing.
+    pub struct Source {
+        inotify: RawFd,
+        wake: RawFd,
+        buf: Vec<u64>,
+    }
+
+    impl Source {
+        pub fn new(dir: &Path) -> io::Result<(Source, Interrupt)> {
+            let inotify = unsafe { libc::inotify_init1(libc::IN_CLOEXEC) };
+            if inotify < 0 {
+                return Err(io::Error::last_os_error());
+            }
+
+            let mut fds = [0; 2];
+            if unsafe { libc::pipe2(fds.as_mut_ptr(), libc::O_CLOEXEC) } < 0 {
+                let err = io::Error::last_os_error();
+                unsafe { libc::close(inotify) };
+                return Err(err);
+            }
+
+            let source = Source {
+                inotify,
+                wake: fds[0],
+                buf: vec![0; 512],
+            };
+            let interrupt = Interrupt(fds[1]);
+
+            let mask = libc::IN_CLOSE_WRITE | libc::IN_MOVED_TO;
+            let added = with_c_str(dir.as_os_str(), |dir| match dir {
+                Some(dir) => unsafe { libc::inotify_add_watch(inotify, dir.as_ptr(), mask) },
+                None => -1,
+            });
+
+            if added < 0 {
+                return Err(io::Error::last_os_error());
+            }
+
+            Ok((source, interrupt))
+        }
+
+        /// Blocks until files are written, appending their names to `names`.
+        pub fn wait(
+            &mut self,
+            timeout: Option<Duration>,
+            names: &mut Vec<OsString>,
+        ) -> io::Result<Wait> {
+            let mut fds = [
+                libc::pollfd {
+                    fd: self.inotify,
+                    events: libc::POLLIN,
+                    revents: 0,
+                },
+                libc::pollfd {
+                    fd: self.wake,
+                    events: libc::POLLIN,
+                    revents: 0,
+                },
+            ];
+
+            let timeout = timeout.map_or(-1, |t| t.as_millis().max(1) as libc::c_int);
+            if unsafe { libc::poll(fds.as_mut_ptr(), 2, timeout) } < 0 {
+                let err = io::Error::last_os_error();
+                return match err.kind() {
+                    io::ErrorKind::Interrupted => Ok(Wait::Events),
+                    _ => Err(err),
+                };
+            }
+
+            if fds[1].revents != 0 {
+                return Ok(Wait::Interrupted);
+            } else if fds[0].revents == 0 {
+                return Ok(Wait::Events);
+            }
+
+            let capacity = self.buf.len() * mem::size_of::<u64>();
+            let raw = self.buf.as_mut_ptr() as *mut u8;
+            let len = unsafe { libc::read(self.inotify, raw as *mut libc::c_void, capacity) };
+            if len < 0 {
+                return Err(io::Error::last_os_error());
+            }
+
+            let mut overflowed = false;
+            let mut offset = 0;
+            let header = mem::size_of::<libc::inotify_event>();
+            while offset + header <= len as usize {
+                let event: libc::inotify_event =
+                    unsafe { ptr::read_unaligned(raw.add(offset) as *const _) };
+                let name = unsafe {
+                    std::slice::from_raw_parts(raw.add(offset + header), event.len as usize)
+                };
+
+                overflowed |= event.mask & libc::IN_Q_OVERFLOW != 0;
+                let name = &name[..name.iter().position(|&b| b == 0).unwrap_or(name.len())];
+                if !name.is_empty() {
+                    names.push(OsString::from_vec(name.to_vec()));
+                }
+
+                offset += header + event.len as usize;
+            }
+
+            Ok(if overflowed {
+                Wait::Overflow
+            } else {
+                Wait::Events
+            })
+        }
+    }
+
+    impl Drop for Source {
+        fn drop(&mut self) {
+            unsafe {
+                libc::close(self.inotify);
+                libc::close(self.wake);
+            }
+        }
+    }
+
+    /// Wakes the watcher thread up to exit.
+    #[derive(Debug)]
+    pub struct Interrupt(RawFd);
+
+    impl Interrupt {
+        pub fn interrupt(&self) {
+            let byte = 1u8;
+            unsafe { libc::write(self.0, &byte as *const u8 as *const libc::c_void, 1) };
+        }
+    }
+
+    impl Drop for Interrupt {
+        fn drop(&mut self) {
+            unsafe { libc::close(self.0) };
+        }
+    }
+}
+
+#[cfg(not(target_os = "linux"))]
+mod sys {
+    use std::ffi::OsString;
+    use std::io;
+    use std::path::Path;
+    use std::sync::mpsc::{self, Receiver, RecvTimeoutError, SyncSender};
+    use std::time::Duration;
+
+    /// Without file events, the watcher thread wakes up periodically to check the capture list.
+    pub const IDLE_TIMEOUT: Option<Duration> = Some(Duration::from_millis(50));
+
+    /// Whether `Source` reports individual files being written.
+    pub const WATCHES_FILES: bool = false;
+
+    /// Outcome of waiting for filesystem events.
+    pub enum Wait {
+        Events,
+        #[allow(dead_code)]
+        Overflow,
+        Interrupted,
+    }
+
+    /// Waits for the next check of the capture list.
+    pub struct Source(Receiver<()>);
+
+    impl Source {
+        pub fn new(_dir: &Path) -> io::Result<(Source, Interrupt)> {
+            let (sender, receiver) = mpsc::sync_channel(1);
+            Ok((Source(receiver), Interrupt(sender)))
+        }
+
+        pub fn wait(
+            &mut self,
+            timeout: Option<Duration>,
+            _: &mut Vec<OsString>,
+        ) -> io::Result<Wait> {
+            match self
+                .0
+                .recv_timeout(timeout.unwrap_or(Duration::from_secs(1)))
+            {
+                Err(RecvTimeoutError::Timeout) => Ok(Wait::Events),
+                _ => Ok(Wait::Interrupted),
+            }
+        }
+    }
+
+    /// Wakes the watcher thread up to exit.
+    #[derive(Debug)]
+    pub struct Interrupt(SyncSender<()>);
+
+    impl Interrupt {
+        pub fn interrupt(&self) {
+            let _ = self.0.try_send(());
+        }
+    }
+}
+
+#[cfg(test)]
+#[cfg(target_os = "linux")]
+mod tests {
+    use super::*;
+    use crate::version::V141;
+    use std::env;
+    use std::process;
+
+    #[test]
+    fn reports_and_awaits_written_captures() {
+        let dir = env::temp_dir().join(format!("renderdoc-rs-completion-{}", process::id()));
+        let mut renderdoc = RenderDoc::<V141>::disabled();
+        let watcher = CompletionWatcher::with_path_template(&renderdoc, dir.join("app")).unwrap();
+        let completed = watcher.subscribe();
+
+        fs::write(dir.join("other_frame1.rdc"), b"RDOC").unwrap();
+        fs::write(dir.join("app_frame2.log"), b"RDOC").unwrap();
+        fs::write(dir.join("app_frame3.rdc"), b"RDOC").unwrap();
+
+        let capture = completed.recv_timeout(Duration::from_secs(5)).unwrap();
+        assert_eq!(capture.path(), dir.join("app_frame3.rdc"));
+        assert_eq!(capture.index(), None);
+
+        // Files missing from the capture list of the disabled handle never resolve a future.
+        let unfinished = watcher.capture_frames(&mut renderdoc, 2);
+        fs::write(dir.join("app_frame4.rdc"), b"RDOC").unwrap();
+        let capture = completed.recv_timeout(Duration::from_secs(5)).unwrap();
+        assert_eq!(capture.path(), dir.join("app_frame4.rdc"));
+
+        drop(watcher);
+        assert!(unfinished.wait().is_empty());
+        assert!(completed.recv().is_err());
+        let _ = fs::remove_dir_all(&dir);
+    }
+
+    #[test]
+    fn futures_only_accept_their_reserved_indices() {
+        let slot = Arc::new(FrameSlot {
+            state: Mutex::new(FrameState {
+                captures: Vec::new(),
+                remaining: 2,
+                first_index: 4,
+                end_index: 6,
+                closed: false,
+                waker: None,
+            }),
+            ready: Condvar::new(),
+        });
+        let subscriber = Subscriber::Future(slot.clone());
+        let future = CaptureFuture { slot };
+
+        let capture = |frame, index| CompletedCapture {
+            path: PathBuf::from(format!("app_frame{}.rdc", frame)),
+            capture_time: SystemTime::UNIX_EPOCH,
+            index,
+        };
+        assert!(subscriber.deliver(&capture(1, None)));
+        assert!(subscriber.deliver(&capture(3, Some(3))));
+        assert!(subscriber.deliver(&capture(6, Some(6))));
+        assert!(subscriber.deliver(&capture(5, Some(5))));
+        assert!(!subscriber.deliver(&capture(4, Some(4))));
+
+        let paths: Vec<PathBuf> = future.wait().into_iter().map(|(path, _)| path).collect();
+        assert_eq!(
+            paths,
+            vec![
+                PathBuf::from("app_frame5.rdc"),
+                PathBuf::from("app_frame4.rdc")
+            ]
+        );
+    }
+
+    #[test]
+    fn dropped_futures_release_their_indices() {
+        let dir = env::temp_dir().join(format!("renderdoc-rs-reserve-{}", process::id()));
+        let mut renderdoc = RenderDoc::<V141>::disabled();
+        let watcher = CompletionWatcher::with_path_template(&renderdoc, dir.join("app")).unwrap();
+        let range = |future: &CaptureFuture| {
+            let state = future.slot.state.lock().unwrap();
+            (state.first_index, state.end_index)
+        };
+
+        let first = watcher.capture_next_frame(&mut renderdoc);
+        let second = watcher.capture_frames(&mut renderdoc, 2);
+        assert_eq!(range(&first), (0, 1));
+        assert_eq!(range(&second), (1, 3));
+
+        drop(second);
+        assert_eq!(range(&watcher.capture_next_frame(&mut renderdoc)), (1, 2));
+        drop(first);
+        assert_eq!(range(&watcher.capture_frames(&mut renderdoc, 3)), (0, 3));
+
+        drop(watcher);
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
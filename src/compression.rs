@@ -0,0 +1,499 @@
+//! Background recompression of finished capture files with zstd.
+
+use std::collections::VecDeque;
+use std::ffi::OsString;
+use std::fs::{self, File};
+use std::io::{self, BufWriter, Read, Write};
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::sync::mpsc::{self, Receiver, SyncSender, TrySendError};
+use std::sync::{Arc, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use crate::captures::CaptureWatcher;
+use crate::renderdoc::RenderDoc;
+use crate::version::V100;
+
+/// Size of the chunks read from and compared against the original capture.
+const CHUNK_SIZE: usize = 1 << 20;
+
+/// Counters describing the work done by a `CompressionPipeline`.
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct CompressionStats {
+    /// Number of captures waiting to be handed to the worker pool.
+    pub backlog: usize,
+    /// Number of captures queued on or being compressed by the worker pool.
+    pub pending: u64,
+    /// Number of captures compressed and verified.
+    pub compressed: u64,
+    /// Number of captures which could not be compressed or failed verification.
+    pub failed: u64,
+    /// Total size in bytes of the compressed captures before compression.
+    pub bytes_in: u64,
+    /// Total size in bytes of the compressed captures after compression.
+    pub bytes_out: u64,
+    /// Total time the worker pool spent compressing and verifying captures.
+    pub busy_time: Duration,
+}
+
+impl CompressionStats {
+    /// Returns the ratio of uncompressed to compressed size, or `None` if nothing was compressed.
+    pub fn ratio(&self) -> Option<f64> {
+        if self.bytes_out == 0 {
+            None
+        } else {
+            Some(self.bytes_in as f64 / self.bytes_out as f64)
+        }
+    }
+
+    /// Returns the average number of uncompressed bytes processed per second of worker time,
+    /// including verification, or `None` if nothing was compressed.
+    pub fn throughput(&self) -> Option<f64> {
+        let secs = self.busy_time.as_secs_f64();
+        if secs > 0.0 {
+            Some(self.bytes_in as f64 / secs)
+        } else {
+            None
+        }
+    }
+}
+
+/// Recompresses finished capture files with zstd on a bounded pool of low priority threads.
+///
+/// Every call to [`update()`] picks up the captures reported by `get_capture()` since the previous
+/// call and hands them to the pool. Each capture is compressed to a `.zst` file next to it, which
+/// is then decompressed again and compared against the original before it replaces it. The
+/// original is only deleted once the output has been verified, and never if compression fails.
+///
+/// The pool only accepts as many captures as it has room for in its queue. Captures beyond that
+/// stay in a backlog on the calling thread and are handed over by later calls, so the calling
+/// thread never blocks on the pool. Worker threads run at the lowest scheduling priority the
+/// platform allows for a single thread, so they yield to the render thread.
+///
+/// Only available with the `zstd` feature.
+///
+/// [`update()`]: #method.update
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CompressionPipeline, Error, RenderDoc, V141};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// let mut pipeline = CompressionPipeline::new().threads(2).level(9);
+///
+/// loop {
+///     // Render a frame here...
+///     pipeline.update(&renderdoc);
+/// #   break;
+/// }
+///
+/// let stats = pipeline.stats();
+/// if let (Some(ratio), Some(throughput)) = (stats.ratio(), stats.throughput()) {
+///     println!("{:.1}x at {:.0} MB/s", ratio, throughput / 1e6);
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct CompressionPipeline {
+    level: i32,
+    threads: usize,
+    queue_capacity: usize,
+    delete_originals: bool,
+    watcher: CaptureWatcher,
+    backlog: VecDeque<PathBuf>,
+    pool: Option<Pool>,
+    stats: Arc<PoolStats>,
+}
+
+impl CompressionPipeline {
+    /// Creates a new pipeline using one thread and zstd's default compression level.
+    pub fn new() -> Self {
+        CompressionPipeline {
+            level: 0,
+            threads: 1,
+            queue_capacity: 4,
+            delete_originals: true,
+            watcher: CaptureWatcher::new(),
+            backlog: VecDeque::new(),
+            pool: None,
+            stats: Arc::new(PoolStats::default()),
+        }
+    }
+
+    /// Sets the zstd compression level, where 0 selects zstd's default.
+    pub fn level(mut self, level: i32) -> Self {
+        self.level = level;
+        self
+    }
+
+    /// Sets the number of worker threads, which is at least one.
+    pub fn threads(mut self, threads: usize) -> Self {
+        self.threads = threads.max(1);
+        self
+    }
+
+    /// Sets how many captures may be queued on the worker pool before further captures are held
+    /// back in the backlog.
+    pub fn queue_capacity(mut self, captures: usize) -> Self {
+        self.queue_capacity = captures;
+        self
+    }
+
+    /// Sets whether original captures are deleted once their compressed copy is verified.
+    ///
+    /// This is enabled by default.
+    pub fn delete_originals(mut self, delete: bool) -> Self {
+        self.delete_originals = delete;
+        self
+    }
+
+    /// Ignores all captures made before this point, leaving them uncompressed.
+    pub fn skip_existing(mut self, renderdoc: &RenderDoc<V100>) -> Self {
+        self.watcher = CaptureWatcher::skip_existing(renderdoc);
+        self
+    }
+
+    /// Returns the current counters of the pipeline.
+    pub fn stats(&self) -> CompressionStats {
+        let submitted = self.stats.submitted.load(Ordering::Relaxed);
+        let compressed = self.stats.compressed.load(Ordering::Relaxed);
+        let failed = self.stats.failed.load(Ordering::Relaxed);
+
+        CompressionStats {
+            backlog: self.backlog.len(),
+            pending: submitted.saturating_sub(compressed + failed),
+            compressed,
+            failed,
+            bytes_in: self.stats.bytes_in.load(Ordering::Relaxed),
+            bytes_out: self.stats.bytes_out.load(Ordering::Relaxed),
+            busy_time: Duration::from_nanos(self.stats.busy_nanos.load(Ordering::Relaxed)),
+        }
+    }
+
+    /// Picks up any new captures and hands as many captures as possible to the worker pool.
+    ///
+    /// Returns the number of captures handed over by this call.
+    pub fn update(&mut self, renderdoc: &RenderDoc<V100>) -> usize {
+        if self.watcher.has_new(renderdoc) {
+            let backlog = &mut self.backlog;
+            backlog.extend(self.watcher.poll(renderdoc).map(|(path, _)| path));
+        }
+
+        self.dispatch()
+    }
+
+    /// Adds a capture file from another source, such as a `CompletionWatcher`, to the backlog and
+    /// hands as many captures as possible to the worker pool.
+    ///
+    /// Returns the number of captures handed over by this call.
+    pub fn submit<P: Into<PathBuf>>(&mut self, path: P) -> usize {
+        self.backlog.push_back(path.into());
+        self.dispatch()
+    }
+
+    fn dispatch(&mut self) -> usize {
+        if self.backlog.is_empty() {
+            return 0;
+        }
+
+        let (stats, threads, capacity) = (&self.stats, self.threads, self.queue_capacity);
+        let pool = self
+            .pool
+            .get_or_insert_with(|| Pool::spawn(threads, capacity, stats.clone()));
+
+        let mut dispatched = 0;
+        while let Some(path) = self.backlog.pop_front() {
+            let job = Job {
+                path,
+                level: self.level,
+                delete_original: self.delete_originals,
+            };
+
+            match pool.sender.as_ref().unwrap().try_send(job) {
+                Ok(()) => {
+                    self.stats.submitted.fetch_add(1, Ordering::Relaxed);
+                    dispatched += 1;
+                }
+                Err(TrySendError::Full(job)) | Err(TrySendError::Disconnected(job)) => {
+                    self.backlog.push_front(job.path);
+                    break;
+                }
+            }
+        }
+
+        dispatched
+    }
+}
+
+impl Default for CompressionPipeline {
+    fn default() -> Self {
+        CompressionPipeline::new()
+    }
+}
+
+#[derive(Debug, Default)]
+struct PoolStats {
+    submitted: AtomicU64,
+    compressed: AtomicU64,
+    failed: AtomicU64,
+    bytes_in: AtomicU64,
+    bytes_out: AtomicU64,
+    busy_nanos: AtomicU64,
+}
+
+/// Request to compress a single capture, sent to the worker pool.
+#[derive(Debug)]
+struct Job {
+    path: PathBuf,
+    level: i32,
+    delete_original: bool,
+}
+
+/// Worker threads compressing captures from a bounded queue.
+#[derive(Debug)]
+struct Pool {
+    sender: Option<SyncSender<Job>>,
+    threads: Vec<JoinHandle<()>>,
+    stop: Arc<AtomicBool>,
+}
+
+impl Pool {
+    fn spawn(threads: usize, capacity: usize, stats: Arc<PoolStats>) -> Self {
+        let (sender, receiver) = mpsc::sync_channel::<Job>(capacity);
+        let receiver = Arc::new(Mutex::new(receiver));
+        let stop = Arc::new(AtomicBool::new(false));
+
+        let threads = (0..threads)
+            .map(|i| {
+                let (receiver, stop, stats) = (receiver.clone(), stop.clone(), stats.clone());
+                thread::Builder::new()
+                    .name(format!("renderdoc-compress-{}", i))
+                    .spawn(move || run_worker(&receiver, &stop, &stats))
+                    .expect("Failed to spawn compression thread")
+            })
+            .collect();
+
+        Pool {
+            sender: Some(sender),
+            threads,
+            stop,
+        }
+    }
+}
+
+impl Drop for Pool {
+    fn drop(&mut self) {
+        // Captures still queued stay on disk uncompressed, and any compression in progress is
+        // abandoned without touching the original.
+        self.stop.store(true, Ordering::Relaxed);
+        drop(self.sender.take());
+        for thread in self.threads.drain(..) {
+            let _ = thread.join();
+        }
+    }
+}
+
+fn run_worker(receiver: &Mutex<Receiver<Job>>, stop: &AtomicBool, stats: &PoolStats) {
+    lower_thread_priority();
+
+    loop {
+        let job = match receiver.lock().unwrap().recv() {
+            Ok(job) => job,
+            Err(_) => return,
+        };
+
+        if stop.load(Ordering::Relaxed) {
+            stats.failed.fetch_add(1, Ordering::Relaxed);
+            continue;
+        }
+
+        let start = Instant::now();
+        let result = compress(&job, stop);
+        let elapsed = start.elapsed();
+        let nanos = elapsed.as_secs() * 1_000_000_000 + u64::from(elapsed.subsec_nanos());
+        stats.busy_nanos.fetch_add(nanos, Ordering::Relaxed);
+
+        match result {
+            Ok((bytes_in, bytes_out)) => {
+                stats.bytes_in.fetch_add(bytes_in, Ordering::Relaxed);
+                stats.bytes_out.fetch_add(bytes_out, Ordering::Relaxed);
+                stats.compressed.fetch_add(1, Ordering::Relaxed);
+            }
+            Err(_) => {
+                stats.failed.fetch_add(1, Ordering::Relaxed);
+            }
+        }
+    }
+}
+
+/// Compresses and verifies a single capture, returning its size before and after compression.
+fn compress(job: &Job, stop: &AtomicBool) -> io::Result<(u64, u64)> {
+    let output = with_extension_suffix(&job.path, ".zst");
+    let partial = with_extension_suffix(&job.path, ".zst.partial");
+
+    let result = encode(&job.path, &partial, job.level, stop)
+        .and_then(|bytes_in| verify(&job.path, &partial).map(|_| bytes_in))
+        .and_then(|bytes_in| {
+            fs::rename(&partial, &output)?;
+            Ok((bytes_in, fs::metadata(&output)?.len()))
+        });
+
+    match result {
+        Ok(sizes) => {
+            if job.delete_original {
+                fs::remove_file(&job.path)?;
+            }
+            Ok(sizes)
+        }
+        Err(e) => {
+            let _ = fs::remove_file(&partial);
+            Err(e)
+        }
+    }
+}
+
+/// Writes the zstd-compressed contents of `input` to `output`, returning the uncompressed size.
+fn encode(input: &Path, output: &Path, level: i32, stop: &AtomicBool) -> io::Result<u64> {
+    let mut reader = File::open(input)?;
+    let writer = BufWriter::new(File::create(output)?);
+    let mut encoder = zstd::stream::write::Encoder::new(writer, level)?;
+
+    let mut chunk = vec![0; CHUNK_SIZE];
+    let mut total = 0;
+    loop {
+        if stop.load(Ordering::Relaxed) {
+            return Err(io::Error::new(
+                io::ErrorKind::Interrupted,
+                "Pipeline stopped",
+            ));
+        }
+
+        let len = reader.read(&mut chunk)?;
+        if len == 0 {
+            break;
+        }
+
+        encoder.write_all(&chunk[..len])?;
+        total += len as u64;
+    }
+
+    let mut writer = encoder.finish()?;
+    writer.flush()?;
+    writer.get_ref().sync_all()?;
+    Ok(total)
+}
+
+/// Checks that `compressed` decompresses to exactly the contents of `original`.
+fn verify(original: &Path, compressed: &Path) -> io::Result<()> {
+    let mut original = File::open(original)?;
+    let mut decoder = zstd::stream::read::Decoder::new(File::open(compressed)?)?;
+
+    let mismatch = || io::Error::new(io::ErrorKind::InvalidData, "Compressed capture differs");
+    let mut expected = vec![0; CHUNK_SIZE];
+    let mut actual = vec![0; CHUNK_SIZE];
+    loop {
+        let len = read_full(&mut original, &mut expected)?;
+        if read_full(&mut decoder, &mut actual[..len])? != len || expected[..len] != actual[..len] {
+            return Err(mismatch());
+        }
+
+        if len < CHUNK_SIZE {
+            // Both streams must end at the same point.
+            let mut byte = [0];
+            return match decoder.read(&mut byte)? {
+                0 => Ok(()),
+                _ => Err(mismatch()),
+            };
+        }
+    }
+}
+
+/// Reads until `buf` is full or the end of the stream, returning the number of bytes read.
+fn read_full<R: Read>(reader: &mut R, buf: &mut [u8]) -> io::Result<usize> {
+    let mut filled = 0;
+    while filled < buf.len() {
+        match reader.read(&mut buf[filled..]) {
+            Ok(0) => break,
+            Ok(len) => filled += len,
+            Err(ref e) if e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+    }
+    Ok(filled)
+}
+
+/// Returns `path` with `suffix` appended to its file name, e.g. `a.rdc` to `a.rdc.zst`.
+fn with_extension_suffix(path: &Path, suffix: &str) -> PathBuf {
+    let mut name = path
+        .file_name()
+        .map_or_else(OsString::new, |n| n.to_owned());
+    name.push(suffix);
+    path.with_file_name(name)
+}
+
+#[cfg(target_os = "linux")]
+fn lower_thread_priority() {
+    // NOTE: On Linux, `setpriority()` applies to the calling thread rather than the process.
+    unsafe {
+        libc::setpriority(libc::PRIO_PROCESS, 0, 19);
+    }
+}
+
+#[cfg(windows)]
+fn lower_thread_priority() {
+    use winapi::um::processthreadsapi::{GetCurrentThread, SetThreadPriority};
+    use winapi::um::winbase::THREAD_PRIORITY_LOWEST;
+
+    unsafe {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST as _);
+    }
+}
+
+#[cfg(not(any(target_os = "linux", windows)))]
+fn lower_thread_priority() {}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::env;
+    use std::process;
+
+    #[test]
+    fn compresses_and_replaces_verified_captures() {
+        let dir = env::temp_dir().join(format!("renderdoc-rs-compression-{}", process::id()));
+        fs::create_dir_all(&dir).unwrap();
+        let capture = dir.join("app_frame1.rdc");
+        let contents: Vec<u8> = (0..3 * CHUNK_SIZE as u32)
+            .map(|i| (i / 1000) as u8)
+            .collect();
+        fs::write(&capture, &contents).unwrap();
+
+        let mut pipeline = CompressionPipeline::new();
+        pipeline.submit(&capture);
+        pipeline.submit(dir.join("missing.rdc"));
+
+        let mut stats = pipeline.stats();
+        while stats.pending > 0 || stats.backlog > 0 {
+            thread::sleep(Duration::from_millis(1));
+            pipeline.dispatch();
+            stats = pipeline.stats();
+        }
+
+        assert_eq!((stats.compressed, stats.failed), (1, 1));
+        assert_eq!(stats.bytes_in, contents.len() as u64);
+        assert!(stats.ratio().unwrap() > 1.0);
+        assert!(!capture.exists());
+
+        let compressed = File::open(with_extension_suffix(&capture, ".zst")).unwrap();
+        let mut decompressed = Vec::new();
+        zstd::stream::read::Decoder::new(compressed)
+            .unwrap()
+            .read_to_end(&mut decompressed)
+            .unwrap();
+        assert!(decompressed == contents);
+        let _ = fs::remove_dir_all(&dir);
+    }
+}
@@ -0,0 +1,355 @@
+//! Thread-safe submission of capture requests to the render thread.
+
+use std::ffi::CString;
+use std::path::PathBuf;
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
+use std::sync::Arc;
+
+use crate::error::Error;
+use crate::renderdoc::RenderDoc;
+use crate::settings::{CaptureOption, OverlayBits};
+use crate::version::V120;
+
+/// A request which can be submitted to a `CaptureController` from any thread.
+#[derive(Clone, Debug)]
+pub enum CaptureCommand {
+    /// Captures the next frame, see `trigger_capture()`.
+    TriggerCapture,
+    /// Captures the next _n_ frames, see `trigger_multi_frame_capture()`.
+    TriggerMultiFrameCapture(u32),
+    /// Attaches comments to a capture file, see `set_capture_file_comments()`.
+    ///
+    /// If the path is `None`, the most recent capture is used. Both strings must be valid UTF-8,
+    /// otherwise the command is ignored.
+    SetCaptureFileComments(Option<CString>, CString),
+    /// Sets the path template of new captures, see `set_capture_file_path_template()`.
+    ///
+    /// The template must be valid UTF-8, otherwise the command is ignored.
+    SetCaptureFilePathTemplate(CString),
+    /// Sets a capture option to an integer value, see `set_capture_option_u32()`.
+    SetCaptureOptionU32(CaptureOption, u32),
+    /// Sets a capture option to a floating-point value, see `set_capture_option_f32()`.
+    SetCaptureOptionF32(CaptureOption, f32),
+    /// Masks the overlay bits, see `mask_overlay_bits()`.
+    MaskOverlayBits(OverlayBits, OverlayBits),
+}
+
+struct Node {
+    command: CaptureCommand,
+    next: *mut Node,
+}
+
+/// Lock-free multi-producer, single-consumer queue of commands.
+///
+/// Producers push onto an intrusive stack with a single compare-and-swap. The consumer detaches
+/// the entire stack with one atomic swap and reverses it to restore submission order. Since the
+/// consumer never removes individual nodes while producers are active, the queue is not
+/// susceptible to the ABA problem.
+struct CommandQueue {
+    head: AtomicPtr<Node>,
+}
+
+// NOTE: The raw node pointers are only ever dereferenced by their unique owner: the producer
+// before publishing the node, and the consumer after detaching it.
+unsafe impl Send for CommandQueue {}
+unsafe impl Sync for CommandQueue {}
+
+impl CommandQueue {
+    fn new() -> Self {
+        CommandQueue {
+            head: AtomicPtr::new(ptr::null_mut()),
+        }
+    }
+
+    fn push(&self, command: CaptureCommand) {
+        let node = Box::into_raw(Box::new(Node {
+            command,
+            next: ptr::null_mut(),
+        }));
+
+        let mut head = self.head.load(Ordering::Relaxed);
+        loop {
+            unsafe { (*node).next = head };
+            match self
+                .head
+                .compare_exchange_weak(head, node, Ordering::Release, Ordering::Relaxed)
+            {
+                Ok(_) => return,
+                Err(current) => head = current,
+            }
+        }
+    }
+
+    /// Detaches all pending commands, returning them as a list in submission order.
+    fn take_all(&self) -> Detached {
+        // Avoid dirtying the cache line shared with the producers when there is nothing to do.
+        if self.head.load(Ordering::Relaxed).is_null() {
+            return Detached(ptr::null_mut());
+        }
+
+        let mut node = self.head.swap(ptr::null_mut(), Ordering::Acquire);
+        let mut reversed = ptr::null_mut();
+        while !node.is_null() {
+            unsafe {
+                let next = (*node).next;
+                (*node).next = reversed;
+                reversed = node;
+                node = next;
+            }
+        }
+
+        Detached(reversed)
+    }
+}
+
+impl Drop for CommandQueue {
+    fn drop(&mut self) {
+        drop(self.take_all());
+    }
+}
+
+/// List of commands detached from a `CommandQueue`, owning its nodes.
+///
+/// Nodes which have not been iterated over are freed on drop, so no commands are leaked if
+/// applying one of them panics.
+struct Detached(*mut Node);
+
+impl Iterator for Detached {
+    type Item = CaptureCommand;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.0.is_null() {
+            return None;
+        }
+
+        let boxed = unsafe { Box::from_raw(self.0) };
+        self.0 = boxed.next;
+        Some(boxed.command)
+    }
+}
+
+impl Drop for Detached {
+    fn drop(&mut self) {
+        self.for_each(drop);
+    }
+}
+
+/// Receives capture requests from any number of threads and applies them on the render thread.
+///
+/// `RenderDoc` is not `Sync` and its mutating methods take `&mut self`, so other threads cannot
+/// call into it without a lock that contends with the render thread. Instead, threads can submit
+/// [`CaptureCommand`]s through cloneable [`CaptureHandle`]s into a lock-free queue. The render
+/// thread applies all pending commands at a frame boundary with a single call to [`drain()`],
+/// which costs one atomic load when the queue is empty.
+///
+/// [`CaptureCommand`]: ./enum.CaptureCommand.html
+/// [`CaptureHandle`]: ./struct.CaptureHandle.html
+/// [`drain()`]: #method.drain
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureController, Error, RenderDoc, V120};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V120> = RenderDoc::new()?;
+/// let mut controller = CaptureController::new();
+///
+/// let handle = controller.handle();
+/// std::thread::spawn(move || {
+///     // Detected a problem while streaming assets...
+///     handle.trigger_capture();
+///     handle.set_capture_file_comments(None, "Streaming stall").unwrap();
+/// });
+///
+/// loop {
+///     // Render a frame here...
+///     controller.drain(&mut renderdoc);
+/// #   break;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+pub struct CaptureController {
+    queue: Arc<CommandQueue>,
+}
+
+impl CaptureController {
+    /// Creates a new `CaptureController` with an empty queue.
+    pub fn new() -> Self {
+        CaptureController {
+            queue: Arc::new(CommandQueue::new()),
+        }
+    }
+
+    /// Returns a new handle for submitting commands to this controller.
+    pub fn handle(&self) -> CaptureHandle {
+        CaptureHandle {
+            queue: self.queue.clone(),
+        }
+    }
+
+    /// Applies all pending commands to `rd` in the order they were submitted.
+    ///
+    /// Returns the number of commands applied.
+    pub fn drain(&mut self, rd: &mut RenderDoc<V120>) -> usize {
+        let mut count = 0;
+        for command in self.queue.take_all() {
+            apply(rd, command);
+            count += 1;
+        }
+
+        count
+    }
+}
+
+impl std::fmt::Debug for CaptureController {
+    fn fmt(&self, fmt: &mut std::fmt::Formatter) -> std::fmt::Result {
+        fmt.debug_struct(stringify!(CaptureController))
+            .field("handles", &(Arc::strong_count(&self.queue) - 1))
+            .finish()
+    }
+}
+
+impl Default for CaptureController {
+    fn default() -> Self {
+        CaptureController::new()
+    }
+}
+
+/// Applies `command` to `rd`, ignoring commands which RenderDoc rejects instead of panicking on
+/// the render thread.
+fn apply(rd: &mut RenderDoc<V120>, command: CaptureCommand) {
+    match command {
+        CaptureCommand::TriggerCapture => rd.trigger_capture(),
+        CaptureCommand::TriggerMultiFrameCapture(n) => rd.trigger_multi_frame_capture(n),
+        CaptureCommand::SetCaptureFileComments(path, comments) => match path {
+            Some(path) => {
+                if let Ok(path) = path.to_str() {
+                    rd.set_capture_file_comments(path, comments)
+                }
+            }
+            None => rd.set_capture_file_comments(None, comments),
+        },
+        CaptureCommand::SetCaptureFilePathTemplate(template) => {
+            rd.set_capture_file_path_template(template)
+        }
+        CaptureCommand::SetCaptureOptionU32(opt, val) => {
+            let _ = rd.try_set_capture_option_u32(opt, val);
+        }
+        CaptureCommand::SetCaptureOptionF32(opt, val) => {
+            let _ = rd.try_set_capture_option_f32(opt, val);
+        }
+        CaptureCommand::MaskOverlayBits(and, or) => rd.mask_overlay_bits(and, or),
+    }
+}
+
+/// Converts a string argument into the form RenderDoc requires, before it is submitted.
+fn c_string<S: Into<String>>(s: S) -> Result<CString, Error> {
+    CString::new(s.into()).map_err(|_| Error::invalid_string())
+}
+
+/// A cloneable, thread-safe handle for submitting commands to a `CaptureController`.
+///
+/// Submitting a command never blocks. Commands submitted after the controller has been dropped
+/// are never applied, and are freed once the last handle is dropped.
+#[derive(Clone)]
+pub struct CaptureHandle {
+    queue: Arc<CommandQueue>,
+}
+
+impl CaptureHandle {
+    /// Submits an arbitrary command.
+    pub fn submit(&self, command: CaptureCommand) {
+        self.queue.push(command);
+    }
+
+    /// Requests a capture of the next frame.
+    pub fn trigger_capture(&self) {
+        self.submit(CaptureCommand::TriggerCapture);
+    }
+
+    /// Requests a capture of the next `num_frames` frames.
+    pub fn trigger_multi_frame_capture(&self, num_frames: u32) {
+        self.submit(CaptureCommand::TriggerMultiFrameCapture(num_frames));
+    }
+
+    /// Requests comments to be attached to the capture file at `path`, or to the most recent
+    /// capture if `path` is `None`.
+    ///
+    /// Returns an error without submitting anything if either string contains a NUL byte.
+    pub fn set_capture_file_comments<'a, P, C>(&self, path: P, comments: C) -> Result<(), Error>
+    where
+        P: Into<Option<&'a str>>,
+        C: Into<String>,
+    {
+        let path = path.into().map(c_string).transpose()?;
+        let comments = c_string(comments)?;
+        self.submit(CaptureCommand::SetCaptureFileComments(path, comments));
+        Ok(())
+    }
+
+    /// Requests a new path template for capture files.
+    ///
+    /// Returns an error without submitting anything if the template is not valid UTF-8 or
+    /// contains a NUL byte.
+    pub fn set_capture_file_path_template<P>(&self, path_template: P) -> Result<(), Error>
+    where
+        P: Into<PathBuf>,
+    {
+        let utf8 = path_template.into().into_os_string().into_string();
+        let template = c_string(utf8.map_err(|_| Error::invalid_string())?)?;
+        self.submit(CaptureCommand::SetCaptureFilePathTemplate(template));
+        Ok(())
+    }
+
+    /// Requests the specified `CaptureOption` to be set to the given `u32` value.
+    pub fn set_capture_option_u32(&self, opt: CaptureOption, val: u32) {
+        self.submit(CaptureCommand::SetCaptureOptionU32(opt, val));
+    }
+
+    /// Requests the specified `CaptureOption` to be set to the given `f32` value.
+    pub fn set_capture_option_f32(&self, opt: CaptureOption, val: f32) {
+        self.submit(CaptureCommand::SetCaptureOptionF32(opt, val));
+    }
+
+    /// Requests the overlay bits to be masked with `and` and `or`.
+    pub fn mask_overlay_bits(&self, and: OverlayBits, or: OverlayBits) {
+        self.submit(CaptureCommand::MaskOverlayBits(and, or));
+    }
+}
+
+impl std::fmt::Debug for CaptureHandle {
+    fn fmt(&self, fmt: &mut std::fmt::Formatter) -> std::fmt::Result {
+        fmt.debug_struct(stringify!(CaptureHandle)).finish()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn drains_in_submission_order() {
+        let queue = CommandQueue::new();
+        for n in 0..4 {
+            queue.push(CaptureCommand::TriggerMultiFrameCapture(n));
+        }
+
+        let order: Vec<_> = queue
+            .take_all()
+            .filter_map(|command| match command {
+                CaptureCommand::TriggerMultiFrameCapture(n) => Some(n),
+                _ => None,
+            })
+            .collect();
+
+        assert_eq!(order, [0, 1, 2, 3]);
+        assert!(queue.take_all().next().is_none());
+
+        let handle = CaptureController::new().handle();
+        assert!(handle.set_capture_file_comments(None, "nul\0byte").is_err());
+        assert!(handle.set_capture_file_path_template("nul\0byte").is_err());
+        assert!(handle.set_capture_file_comments(None, "Hitch").is_ok());
+    }
+}
@@ -0,0 +1,262 @@
+//! RenderDoc API handle whose version is chosen at runtime.
+
+use std::fmt::{Debug, Formatter, Result as FmtResult};
+use std::ops::{Deref, DerefMut};
+use std::path::Path;
+use std::sync::atomic::{AtomicU32, Ordering};
+
+use crate::error::Error;
+use crate::handles::{DevicePointer, WindowHandle};
+use crate::marshal::{CStrArg, OptCStrArg};
+use crate::renderdoc::RenderDoc;
+use crate::version::{Version, VersionCode, V100, V110, V111, V112, V120, V130, V140, V141};
+
+/// Highest version supported by the loaded library, or zero if not probed yet.
+static BEST_VERSION: AtomicU32 = AtomicU32::new(0);
+
+/// Candidate versions in descending order, limited to those with a version marker type.
+const CANDIDATES: [VersionCode; 8] = [
+    VersionCode::V141,
+    VersionCode::V140,
+    VersionCode::V130,
+    VersionCode::V120,
+    VersionCode::V112,
+    VersionCode::V111,
+    VersionCode::V110,
+    VersionCode::V100,
+];
+
+/// An instance of the RenderDoc API using the newest version supported by the loaded library.
+///
+/// This `struct` is created by [`RenderDoc::new_best()`]. Functionality available since API
+/// version 1.0.0 is accessible directly through `Deref` to `RenderDoc<V100>`. Newer functions
+/// return an error if the library is too old to provide them, and [`get()`] and [`get_mut()`]
+/// give access to the statically typed API of any supported version.
+///
+/// [`RenderDoc::new_best()`]: ./struct.RenderDoc.html#method.new_best
+/// [`get()`]: #method.get
+/// [`get_mut()`]: #method.get_mut
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{Error, RenderDoc, V140};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc = RenderDoc::new_best()?;
+/// println!("Using RenderDoc API {}", renderdoc.version());
+///
+/// renderdoc.start_frame_capture(std::ptr::null(), std::ptr::null());
+/// // Do some rendering here...
+/// if renderdoc.discard_frame_capture(std::ptr::null(), std::ptr::null()).is_err() {
+///     // Discarding requires API version 1.4.0, so save the capture instead.
+///     renderdoc.end_frame_capture(std::ptr::null(), std::ptr::null());
+/// }
+///
+/// if let Ok(v140) = renderdoc.get_mut::<V140>() {
+///     v140.trigger_multi_frame_capture(3);
+/// }
+/// # Ok(())
+/// # }
+/// ```
+pub struct DynRenderDoc {
+    inner: RenderDoc<V141>,
+    version: VersionCode,
+}
+
+impl DynRenderDoc {
+    /// Loads the RenderDoc API, negotiating the newest version supported by the library.
+    ///
+    /// The negotiated version is cached, so only the first call performs any probing.
+    pub(crate) fn new() -> Result<Self, Error> {
+        let cached = BEST_VERSION.load(Ordering::Acquire);
+        if let Some(&version) = CANDIDATES.iter().find(|&&v| v as u32 == cached) {
+            return Ok(DynRenderDoc {
+                inner: open(version)?,
+                version,
+            });
+        }
+
+        let base = RenderDoc::<V100>::new()?;
+        if base.is_disabled() {
+            BEST_VERSION.store(VersionCode::V141 as u32, Ordering::Release);
+            return Ok(DynRenderDoc {
+                inner: RenderDoc::disabled(),
+                version: VersionCode::V141,
+            });
+        }
+
+        // Ask the library for its own version rather than trying every version in turn, then
+        // fall back down the chain in case it refuses the version it reports.
+        let (major, minor, patch) = base.get_api_version();
+        let reported = major * 10000 + minor * 100 + patch;
+        let start = CANDIDATES
+            .iter()
+            .position(|&v| v as u32 <= reported)
+            .unwrap_or(CANDIDATES.len() - 1);
+
+        for &version in &CANDIDATES[start..] {
+            if let Ok(inner) = open(version) {
+                BEST_VERSION.store(version as u32, Ordering::Release);
+                return Ok(DynRenderDoc { inner, version });
+            }
+        }
+
+        Err(Error::no_compatible_api())
+    }
+
+    /// Returns the API version in use.
+    pub fn version(&self) -> VersionCode {
+        self.version
+    }
+
+    /// Returns whether the functionality of API version `V` is available.
+    pub fn supports<V: Version>(&self) -> bool {
+        V::VERSION <= self.version
+    }
+
+    /// Returns the statically typed API of version `V`, if supported by the library.
+    pub fn get<V: Version>(&self) -> Result<&RenderDoc<V>, Error> {
+        self.require(V::VERSION)?;
+        // NOTE: `RenderDoc<V>` is `#[repr(C)]` and its layout does not depend on `V`.
+        Ok(unsafe { &*(&self.inner as *const RenderDoc<V141> as *const RenderDoc<V>) })
+    }
+
+    /// Returns the mutable, statically typed API of version `V`, if supported by the library.
+    pub fn get_mut<V: Version>(&mut self) -> Result<&mut RenderDoc<V>, Error> {
+        self.require(V::VERSION)?;
+        Ok(unsafe { &mut *(&mut self.inner as *mut RenderDoc<V141> as *mut RenderDoc<V>) })
+    }
+
+    /// Captures the next _n_ frames, see `RenderDoc::<V110>::trigger_multi_frame_capture()`.
+    pub fn trigger_multi_frame_capture(&mut self, num_frames: u32) -> Result<(), Error> {
+        self.get_mut::<V110>()?
+            .trigger_multi_frame_capture(num_frames);
+        Ok(())
+    }
+
+    /// Returns whether the RenderDoc UI is connected, see
+    /// `RenderDoc::<V111>::is_target_control_connected()`.
+    pub fn is_target_control_connected(&self) -> Result<bool, Error> {
+        Ok(self.get::<V111>()?.is_target_control_connected())
+    }
+
+    /// Returns the path template where new captures will be stored, see
+    /// `RenderDoc::<V112>::get_capture_file_path_template()`.
+    pub fn get_capture_file_path_template(&self) -> Result<&Path, Error> {
+        Ok(self.get::<V112>()?.get_capture_file_path_template())
+    }
+
+    /// Sets the path template where new captures will be stored, see
+    /// `RenderDoc::<V112>::set_capture_file_path_template()`.
+    pub fn set_capture_file_path_template<P>(&mut self, path_template: P) -> Result<(), Error>
+    where
+        P: CStrArg,
+    {
+        self.get_mut::<V112>()?
+            .set_capture_file_path_template(path_template);
+        Ok(())
+    }
+
+    /// Adds or sets an arbitrary comments field to a capture, see
+    /// `RenderDoc::<V120>::set_capture_file_comments()`.
+    pub fn set_capture_file_comments<P, C>(&mut self, path: P, comments: C) -> Result<(), Error>
+    where
+        P: OptCStrArg,
+        C: CStrArg,
+    {
+        self.get_mut::<V120>()?
+            .set_capture_file_comments(path, comments);
+        Ok(())
+    }
+
+    /// Ends capturing immediately and discards any data without saving to disk, see
+    /// `RenderDoc::<V140>::discard_frame_capture()`.
+    pub fn discard_frame_capture<D>(&mut self, dev: D, win: WindowHandle) -> Result<bool, Error>
+    where
+        D: Into<DevicePointer>,
+    {
+        Ok(self.get_mut::<V140>()?.discard_frame_capture(dev, win))
+    }
+
+    fn require(&self, required: VersionCode) -> Result<(), Error> {
+        if required <= self.version {
+            Ok(())
+        } else {
+            Err(Error::unsupported(required, self.version))
+        }
+    }
+}
+
+/// Loads the API at `version`, resolving only the functions that version provides.
+fn open(version: VersionCode) -> Result<RenderDoc<V141>, Error> {
+    fn open_as<V: Version>() -> Result<RenderDoc<V141>, Error> {
+        // NOTE: Functions newer than `V` are inert stubs, which `DynRenderDoc` never exposes.
+        RenderDoc::<V>::new().map(|rd| unsafe { rd.retag() })
+    }
+
+    match version {
+        VersionCode::V141 => open_as::<V141>(),
+        VersionCode::V140 => open_as::<V140>(),
+        VersionCode::V130 => open_as::<V130>(),
+        VersionCode::V120 => open_as::<V120>(),
+        VersionCode::V112 => open_as::<V112>(),
+        VersionCode::V111 => open_as::<V111>(),
+        VersionCode::V110 => open_as::<V110>(),
+        _ => open_as::<V100>(),
+    }
+}
+
+impl Debug for DynRenderDoc {
+    fn fmt(&self, fmt: &mut Formatter) -> FmtResult {
+        fmt.debug_struct(stringify!(DynRenderDoc))
+            .field("entry", unsafe { &self.inner.raw_api() })
+            .field("version", &self.version)
+            .finish()
+    }
+}
+
+#[doc(hidden)]
+impl Deref for DynRenderDoc {
+    type Target = RenderDoc<V100>;
+
+    fn deref(&self) -> &Self::Target {
+        self.get::<V100>().unwrap()
+    }
+}
+
+#[doc(hidden)]
+impl DerefMut for DynRenderDoc {
+    fn deref_mut(&mut self) -> &mut Self::Target {
+        self.get_mut::<V100>().unwrap()
+    }
+}
+
+#[cfg(test)]
+#[cfg(not(feature = "disabled"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn versions_above_the_negotiated_one_are_unsupported() {
+        let mut renderdoc = DynRenderDoc {
+            inner: RenderDoc::isolated(),
+            version: VersionCode::V120,
+        };
+
+        assert!(renderdoc.supports::<V120>());
+        assert!(!renderdoc.supports::<V130>());
+        assert!(renderdoc.get::<V112>().is_ok());
+        assert!(renderdoc.get_mut::<V120>().is_ok());
+
+        let err = renderdoc.get::<V140>().unwrap_err();
+        assert_eq!(
+            err.to_string(),
+            "Requires API version 1.4.0, but library only provides 1.2.0"
+        );
+        assert!(renderdoc.get_mut::<V141>().is_err());
+        assert!(renderdoc.trigger_multi_frame_capture(2).is_ok());
+        assert!(renderdoc
+            .discard_frame_capture(std::ptr::null(), std::ptr::null())
+            .is_err());
+    }
+}
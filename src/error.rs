@@ -1,6 +1,9 @@
 //! Common library error types.
 
 use std::fmt::{self, Display, Formatter};
+use std::io;
+
+use crate::version::VersionCode;
 
 /// Errors that can occur with the RenderDoc in-application API.
 #[derive(Debug)]
@@ -19,9 +22,32 @@ impl Error {
         Error(ErrorKind::NoCompatibleApi)
     }
 
+    pub(crate) fn missing_function(name: &'static str) -> Self {
+        Error(ErrorKind::MissingFunction(name))
+    }
+
+    pub(crate) fn unsupported(required: VersionCode, available: VersionCode) -> Self {
+        Error(ErrorKind::Unsupported {
+            required,
+            available,
+        })
+    }
+
     pub(crate) fn launch_replay_ui() -> Self {
         Error(ErrorKind::LaunchReplayUi)
     }
+
+    pub(crate) fn end_frame_capture() -> Self {
+        Error(ErrorKind::EndFrameCapture)
+    }
+
+    pub(crate) fn watch(cause: io::Error) -> Self {
+        Error(ErrorKind::Watch(cause))
+    }
+
+    pub(crate) fn invalid_string() -> Self {
+        Error(ErrorKind::InvalidString)
+    }
 }
 
 impl Display for Error {
@@ -30,7 +56,21 @@ impl Display for Error {
             ErrorKind::Library(_) => write!(f, "Unable to load RenderDoc shared library"),
             ErrorKind::Symbol(_) => write!(f, "Unable to find `RENDERDOC_GetAPI` symbol"),
             ErrorKind::NoCompatibleApi => write!(f, "Library could not provide compatible API"),
+            ErrorKind::MissingFunction(name) => {
+                write!(f, "Library does not provide API function `{}`", name)
+            }
+            ErrorKind::Unsupported {
+                required,
+                available,
+            } => write!(
+                f,
+                "Requires API version {}, but library only provides {}",
+                required, available
+            ),
             ErrorKind::LaunchReplayUi => write!(f, "Failed to launch replay UI"),
+            ErrorKind::EndFrameCapture => write!(f, "Failed to end frame capture"),
+            ErrorKind::Watch(_) => write!(f, "Unable to watch capture directory"),
+            ErrorKind::InvalidString => write!(f, "String is not valid UTF-8 or contains a NUL"),
         }
     }
 }
@@ -39,6 +79,7 @@ impl std::error::Error for Error {
     fn source(&self) -> Option<&(dyn std::error::Error + 'static)> {
         match self.0 {
             ErrorKind::Library(ref e) | ErrorKind::Symbol(ref e) => Some(e),
+            ErrorKind::Watch(ref e) => Some(e),
             _ => None,
         }
     }
@@ -49,5 +90,13 @@ enum ErrorKind {
     Library(libloading::Error),
     Symbol(libloading::Error),
     NoCompatibleApi,
+    MissingFunction(&'static str),
+    Unsupported {
+        required: VersionCode,
+        available: VersionCode,
+    },
     LaunchReplayUi,
+    EndFrameCapture,
+    Watch(io::Error),
+    InvalidString,
 }
@@ -0,0 +1,151 @@
+//! Scoped frame captures.
+
+use std::fmt::{Debug, Formatter, Result as FmtResult};
+use std::mem::ManuallyDrop;
+use std::os::raw::c_void;
+
+use crate::backend::Backend;
+use crate::handles::{DevicePointer, WindowHandle};
+use crate::renderdoc::RenderDoc;
+use crate::version::{Version, VersionCode};
+
+/// A frame capture in progress for a specific device/window combination.
+///
+/// This `struct` is created by the [`begin_capture()`] method on `RenderDoc`. The capture is
+/// saved to disk by calling [`finish()`]. If the guard is dropped without being finished, e.g.
+/// because of an early return or a panic, the capture is ended automatically so that RenderDoc is
+/// never left capturing. With API version 1.4.0 and newer, the unfinished capture is discarded
+/// without being written to disk; with older versions, it is ended and saved as usual.
+///
+/// The guard makes exactly the same calls into RenderDoc as using `start_frame_capture()` and
+/// `end_frame_capture()` directly, and does not allocate.
+///
+/// [`begin_capture()`]: ./struct.RenderDoc.html#method.begin_capture
+/// [`finish()`]: #method.finish
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{Error, RenderDoc, V140};
+/// # fn render() -> Result<(), Error> { Ok(()) }
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V140> = RenderDoc::new()?;
+///
+/// let capture = renderdoc.begin_capture(std::ptr::null(), std::ptr::null());
+/// render()?; // If this returns early, the capture is discarded.
+/// capture.finish();
+/// # Ok(())
+/// # }
+/// ```
+#[must_use = "dropping the guard ends the capture immediately"]
+pub struct FrameCapture<'a, V: Version> {
+    renderdoc: &'a mut RenderDoc<V>,
+    device: *mut c_void,
+    window: *mut c_void,
+}
+
+impl<'a, V: Version> FrameCapture<'a, V> {
+    pub(crate) fn new<D>(renderdoc: &'a mut RenderDoc<V>, dev: D, win: WindowHandle) -> Self
+    where
+        D: Into<DevicePointer>,
+    {
+        let DevicePointer(dev) = dev.into();
+        let (device, window) = (dev as *mut c_void, win as *mut c_void);
+
+        unsafe {
+            renderdoc.table().start_frame_capture(device, window);
+        }
+
+        FrameCapture {
+            renderdoc,
+            device,
+            window,
+        }
+    }
+
+    /// Returns the RenderDoc instance which is performing the capture.
+    pub fn renderdoc(&self) -> &RenderDoc<V> {
+        self.renderdoc
+    }
+
+    /// Ends the frame capture, saving the results to disk.
+    pub fn finish(self) {
+        let this = ManuallyDrop::new(self);
+        unsafe {
+            this.renderdoc
+                .table()
+                .end_frame_capture(this.device, this.window);
+        }
+    }
+}
+
+impl<'a, V: Version> Debug for FrameCapture<'a, V> {
+    fn fmt(&self, fmt: &mut Formatter) -> FmtResult {
+        fmt.debug_struct(stringify!(FrameCapture))
+            .field("renderdoc", &self.renderdoc)
+            .field("device", &self.device)
+            .field("window", &self.window)
+            .finish()
+    }
+}
+
+impl<'a, V: Version> Drop for FrameCapture<'a, V> {
+    fn drop(&mut self) {
+        let table = self.renderdoc.table();
+
+        // NOTE: `V::VERSION` is a constant, so only one of these branches survives compilation.
+        unsafe {
+            if V::VERSION >= VersionCode::V140 {
+                table.discard_frame_capture(self.device, self.window);
+            } else {
+                table.end_frame_capture(self.device, self.window);
+            }
+        }
+    }
+}
+
+#[cfg(test)]
+#[cfg(all(feature = "mock", not(feature = "disabled")))]
+mod tests {
+    use crate::mock::{self, Function};
+    use crate::renderdoc::RenderDoc;
+    use crate::version::{V130, V141};
+    use std::ptr;
+
+    /// Returns the number of `EndFrameCapture` and `DiscardFrameCapture` calls made by `f`.
+    fn ends<F: FnOnce()>(f: F) -> (u64, u64) {
+        let end = mock::call_count(Function::EndFrameCapture);
+        let discard = mock::call_count(Function::DiscardFrameCapture);
+        f();
+        (
+            mock::call_count(Function::EndFrameCapture) - end,
+            mock::call_count(Function::DiscardFrameCapture) - discard,
+        )
+    }
+
+    #[test]
+    fn dropped_guards_discard_where_supported() {
+        let _lock = mock::lock_for_test();
+        let mut v141 = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+        let mut v130 = unsafe { RenderDoc::<V130>::from_raw(mock::entry()).unwrap() };
+
+        let starts = mock::call_count(Function::StartFrameCapture);
+        assert_eq!(
+            ends(|| drop(v141.begin_capture(ptr::null(), ptr::null()))),
+            (0, 1)
+        );
+        assert_eq!(
+            ends(|| drop(v130.begin_capture(ptr::null(), ptr::null()))),
+            (1, 0)
+        );
+        assert_eq!(
+            ends(|| v141.begin_capture(ptr::null(), ptr::null()).finish()),
+            (1, 0)
+        );
+        assert_eq!(
+            ends(|| v130.begin_capture(ptr::null(), ptr::null()).finish()),
+            (1, 0)
+        );
+        assert_eq!(mock::call_count(Function::StartFrameCapture) - starts, 4);
+    }
+}
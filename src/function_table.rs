@@ -0,0 +1,244 @@
+//! Pre-resolved table of RenderDoc API function pointers.
+
+use std::hash::{Hash, Hasher};
+use std::os::raw::{c_char, c_int, c_void};
+use std::ptr;
+
+use crate::error::Error;
+use crate::version::{Entry, VersionCode};
+
+type DevicePointer = *mut c_void;
+type WindowHandle = *mut c_void;
+
+/// Function pointers of the RenderDoc API, resolved and validated once for a given version.
+///
+/// Every pointer in the table is guaranteed to be callable. Functions introduced after the
+/// requested API version are never read from the entry point, since older RenderDoc releases may
+/// return a shorter structure, and are filled in with inert stubs instead. The type-level version
+/// markers on `RenderDoc<V>` ensure these stubs are never reached through the public API.
+#[derive(Clone, Copy)]
+pub(crate) struct FunctionTable {
+    pub entry: *mut Entry,
+    pub get_api_version: unsafe extern "C" fn(*mut c_int, *mut c_int, *mut c_int),
+    pub set_capture_option_u32: unsafe extern "C" fn(u32, u32) -> c_int,
+    pub set_capture_option_f32: unsafe extern "C" fn(u32, f32) -> c_int,
+    pub get_capture_option_u32: unsafe extern "C" fn(u32) -> u32,
+    pub get_capture_option_f32: unsafe extern "C" fn(u32) -> f32,
+    pub set_focus_toggle_keys: unsafe extern "C" fn(*mut u32, c_int),
+    pub set_capture_keys: unsafe extern "C" fn(*mut u32, c_int),
+    pub get_overlay_bits: unsafe extern "C" fn() -> u32,
+    pub mask_overlay_bits: unsafe extern "C" fn(u32, u32),
+    pub remove_hooks: unsafe extern "C" fn(),
+    pub unload_crash_handler: unsafe extern "C" fn(),
+    pub set_capture_file_path_template: unsafe extern "C" fn(*const c_char),
+    pub get_capture_file_path_template: unsafe extern "C" fn() -> *const c_char,
+    pub get_num_captures: unsafe extern "C" fn() -> u32,
+    pub get_capture: unsafe extern "C" fn(u32, *mut c_char, *mut u32, *mut u64) -> u32,
+    pub trigger_capture: unsafe extern "C" fn(),
+    pub is_target_control_connected: unsafe extern "C" fn() -> u32,
+    pub launch_replay_ui: unsafe extern "C" fn(u32, *const c_char) -> u32,
+    pub set_active_window: unsafe extern "C" fn(DevicePointer, WindowHandle),
+    pub start_frame_capture: unsafe extern "C" fn(DevicePointer, WindowHandle),
+    pub is_frame_capturing: unsafe extern "C" fn() -> u32,
+    pub end_frame_capture: unsafe extern "C" fn(DevicePointer, WindowHandle) -> u32,
+    pub trigger_multi_frame_capture: unsafe extern "C" fn(u32),
+    pub set_capture_file_comments: unsafe extern "C" fn(*const c_char, *const c_char),
+    pub discard_frame_capture: unsafe extern "C" fn(DevicePointer, WindowHandle) -> u32,
+}
+
+/// Extracts a required function pointer from the entry point, returning early if it is missing.
+macro_rules! require {
+    ($entry:expr, $($field:ident).+) => {
+        match $entry.$($field).+ {
+            Some(f) => f,
+            None => return Err(Error::missing_function(stringify!($($field).+))),
+        }
+    };
+}
+
+/// Extracts a function pointer introduced in API version `$since`, falling back to an inert stub
+/// if the requested version predates it.
+macro_rules! require_since {
+    ($entry:expr, $version:expr, $since:ident, $($field:ident).+, $stub:expr) => {
+        if $version >= VersionCode::$since {
+            require!($entry, $($field).+)
+        } else {
+            $stub
+        }
+    };
+}
+
+impl FunctionTable {
+    /// Resolves and validates every function pointer required by API `version`.
+    ///
+    /// # Safety
+    ///
+    /// `entry` must either be null or point to a valid API structure of at least `version`, which
+    /// must outlive any use of the returned table.
+    pub unsafe fn resolve(entry: *mut Entry, version: VersionCode) -> Result<Self, Error> {
+        if entry.is_null() {
+            return Err(Error::no_compatible_api());
+        }
+
+        let api = &*entry;
+        Ok(FunctionTable {
+            entry,
+            get_api_version: require!(api, GetAPIVersion),
+            set_capture_option_u32: require!(api, SetCaptureOptionU32),
+            set_capture_option_f32: require!(api, SetCaptureOptionF32),
+            get_capture_option_u32: require!(api, GetCaptureOptionU32),
+            get_capture_option_f32: require!(api, GetCaptureOptionF32),
+            set_focus_toggle_keys: require!(api, SetFocusToggleKeys),
+            set_capture_keys: require!(api, SetCaptureKeys),
+            get_overlay_bits: require!(api, GetOverlayBits),
+            mask_overlay_bits: require!(api, MaskOverlayBits),
+            remove_hooks: require!(api, __bindgen_anon_1.RemoveHooks),
+            unload_crash_handler: require!(api, UnloadCrashHandler),
+            set_capture_file_path_template: require!(
+                api,
+                __bindgen_anon_2.SetCaptureFilePathTemplate
+            ),
+            get_capture_file_path_template: require!(
+                api,
+                __bindgen_anon_3.GetCaptureFilePathTemplate
+            ),
+            get_num_captures: require!(api, GetNumCaptures),
+            get_capture: require!(api, GetCapture),
+            trigger_capture: require!(api, TriggerCapture),
+            is_target_control_connected: require!(api, __bindgen_anon_4.IsTargetControlConnected),
+            launch_replay_ui: require!(api, LaunchReplayUI),
+            set_active_window: require!(api, SetActiveWindow),
+            start_frame_capture: require!(api, StartFrameCapture),
+            is_frame_capturing: require!(api, IsFrameCapturing),
+            end_frame_capture: require!(api, EndFrameCapture),
+            trigger_multi_frame_capture: require_since!(
+                api,
+                version,
+                V110,
+                TriggerMultiFrameCapture,
+                stubs::trigger_multi_frame_capture
+            ),
+            set_capture_file_comments: require_since!(
+                api,
+                version,
+                V120,
+                SetCaptureFileComments,
+                stubs::set_capture_file_comments
+            ),
+            discard_frame_capture: require_since!(
+                api,
+                version,
+                V140,
+                DiscardFrameCapture,
+                stubs::discard_frame_capture
+            ),
+        })
+    }
+
+    /// Returns a table of inert stubs which do nothing, with a null entry point.
+    ///
+    /// Setters report success and getters return zero, so the `RenderDoc` methods built on top of
+    /// them never panic.
+    pub fn stubbed() -> Self {
+        FunctionTable {
+            entry: ptr::null_mut(),
+            get_api_version: stubs::get_api_version,
+            set_capture_option_u32: stubs::set_capture_option_u32,
+            set_capture_option_f32: stubs::set_capture_option_f32,
+            get_capture_option_u32: stubs::get_capture_option_u32,
+            get_capture_option_f32: stubs::get_capture_option_f32,
+            set_focus_toggle_keys: stubs::set_keys,
+            set_capture_keys: stubs::set_keys,
+            get_overlay_bits: stubs::get_u32,
+            mask_overlay_bits: stubs::mask_overlay_bits,
+            remove_hooks: stubs::nothing,
+            unload_crash_handler: stubs::nothing,
+            set_capture_file_path_template: stubs::set_capture_file_path_template,
+            get_capture_file_path_template: stubs::get_capture_file_path_template,
+            get_num_captures: stubs::get_u32,
+            get_capture: stubs::get_capture,
+            trigger_capture: stubs::nothing,
+            is_target_control_connected: stubs::get_u32,
+            launch_replay_ui: stubs::launch_replay_ui,
+            set_active_window: stubs::set_active_window,
+            start_frame_capture: stubs::set_active_window,
+            is_frame_capturing: stubs::get_u32,
+            end_frame_capture: stubs::discard_frame_capture,
+            trigger_multi_frame_capture: stubs::trigger_multi_frame_capture,
+            set_capture_file_comments: stubs::set_capture_file_comments,
+            discard_frame_capture: stubs::discard_frame_capture,
+        }
+    }
+}
+
+impl Eq for FunctionTable {}
+
+impl PartialEq for FunctionTable {
+    fn eq(&self, other: &Self) -> bool {
+        ptr::eq(self.entry, other.entry)
+    }
+}
+
+impl Hash for FunctionTable {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.entry.hash(state);
+    }
+}
+
+/// Inert stand-ins for functions which are unavailable in the requested API version, or for every
+/// function of a disabled table.
+mod stubs {
+    use std::os::raw::{c_char, c_int, c_void};
+
+    pub unsafe extern "C" fn nothing() {}
+
+    pub unsafe extern "C" fn get_u32() -> u32 {
+        0
+    }
+
+    pub unsafe extern "C" fn get_api_version(_: *mut c_int, _: *mut c_int, _: *mut c_int) {}
+
+    pub unsafe extern "C" fn set_capture_option_u32(_: u32, _: u32) -> c_int {
+        1
+    }
+
+    pub unsafe extern "C" fn set_capture_option_f32(_: u32, _: f32) -> c_int {
+        1
+    }
+
+    pub unsafe extern "C" fn get_capture_option_u32(_: u32) -> u32 {
+        0
+    }
+
+    pub unsafe extern "C" fn get_capture_option_f32(_: u32) -> f32 {
+        0.0
+    }
+
+    pub unsafe extern "C" fn set_keys(_: *mut u32, _: c_int) {}
+
+    pub unsafe extern "C" fn mask_overlay_bits(_: u32, _: u32) {}
+
+    pub unsafe extern "C" fn set_capture_file_path_template(_: *const c_char) {}
+
+    pub unsafe extern "C" fn get_capture_file_path_template() -> *const c_char {
+        b"\0".as_ptr() as *const c_char
+    }
+
+    pub unsafe extern "C" fn get_capture(_: u32, _: *mut c_char, _: *mut u32, _: *mut u64) -> u32 {
+        0
+    }
+
+    pub unsafe extern "C" fn launch_replay_ui(_: u32, _: *const c_char) -> u32 {
+        0
+    }
+
+    pub unsafe extern "C" fn set_active_window(_: *mut c_void, _: *mut c_void) {}
+
+    pub unsafe extern "C" fn trigger_multi_frame_capture(_: u32) {}
+
+    pub unsafe extern "C" fn set_capture_file_comments(_: *const c_char, _: *const c_char) {}
+
+    pub unsafe extern "C" fn discard_frame_capture(_: *mut c_void, _: *mut c_void) -> u32 {
+        0
+    }
+}
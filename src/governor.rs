@@ -0,0 +1,406 @@
+//! Automatic tuning of expensive capture options against an overhead budget.
+
+use std::time::Duration;
+
+use crate::overhead::{CapturePhase, CaptureProfiler, OverheadMetric};
+use crate::profile::CaptureProfile;
+use crate::renderdoc::RenderDoc;
+use crate::settings::CaptureOption;
+use crate::version::V100;
+
+/// Weight of a new sample in the overhead estimates.
+const EWMA_ALPHA: f64 = 0.3;
+
+/// Options disabled by default when over budget, roughly in order of decreasing cost.
+const DEFAULT_LADDER: [CaptureOption; 4] = [
+    CaptureOption::ApiValidation,
+    CaptureOption::CaptureCallstacks,
+    CaptureOption::RefAllResources,
+    CaptureOption::SaveAllInitials,
+];
+
+/// A change to the capture options made by an `OverheadGovernor`.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum GovernorAction {
+    /// The option was disabled because capture overhead exceeded the budget.
+    Downgraded(CaptureOption),
+    /// The option was restored to its original value because there was headroom again.
+    Restored(CaptureOption),
+}
+
+/// Keeps capture overhead within a budget by disabling expensive capture options.
+///
+/// The governor keeps exponentially weighted estimates of the time spent in `end_frame_capture()`
+/// and of the frame time inflation of captured frames, fed either by [`observe()`] from a
+/// `CaptureProfiler` or directly with [`record_end_frame_capture()`] and
+/// [`record_frame_inflation()`]. While an estimate exceeds its budget, each call to [`update()`]
+/// disables the next option of its ladder, which by default is `ApiValidation`,
+/// `CaptureCallstacks`, `RefAllResources` and then `SaveAllInitials`. Once both estimates fall
+/// below the headroom fraction of their budgets, the most recently disabled option is restored to
+/// the value it had when the governor first took control.
+///
+/// After every change, the estimates start over and no further change is made until enough new
+/// samples have been measured with the new options.
+///
+/// [`observe()`]: #method.observe
+/// [`record_end_frame_capture()`]: #method.record_end_frame_capture
+/// [`record_frame_inflation()`]: #method.record_frame_inflation
+/// [`update()`]: #method.update
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureProfiler, Error, OverheadGovernor, RenderDoc, V141};
+/// # use std::time::{Duration, Instant};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// let profiler = CaptureProfiler::new();
+/// let mut governor = OverheadGovernor::new()
+///     .end_frame_capture_budget(Duration::from_millis(200))
+///     .frame_inflation_budget(Duration::from_millis(8));
+///
+/// loop {
+///     let start = Instant::now();
+///     profiler.start_frame_capture(&mut renderdoc, std::ptr::null(), std::ptr::null());
+///     // Do some rendering here...
+///     profiler.end_frame_capture(&mut renderdoc, std::ptr::null(), std::ptr::null());
+///     profiler.on_frame(start.elapsed());
+///
+///     governor.observe(&profiler);
+///     if let Some(action) = governor.update(&mut renderdoc) {
+///         println!("Capture overhead governor: {:?}", action);
+///     }
+/// #   break;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone, Debug)]
+pub struct OverheadGovernor {
+    end_budget: Option<Duration>,
+    inflation_budget: Option<Duration>,
+    headroom: f64,
+    min_samples: u32,
+    ladder: Vec<CaptureOption>,
+    original: Option<CaptureProfile>,
+    disabled: Vec<CaptureOption>,
+    end: Estimate,
+    inflation: Estimate,
+    seen_end: (u64, Duration),
+    seen_inflation: (u64, Duration),
+}
+
+impl OverheadGovernor {
+    /// Creates a new governor without any budget, which never changes any option.
+    ///
+    /// By default, options are restored below half of the budget, and at least 3 samples are
+    /// required between changes.
+    pub fn new() -> Self {
+        OverheadGovernor {
+            end_budget: None,
+            inflation_budget: None,
+            headroom: 0.5,
+            min_samples: 3,
+            ladder: DEFAULT_LADDER.to_vec(),
+            original: None,
+            disabled: Vec::new(),
+            end: Estimate::default(),
+            inflation: Estimate::default(),
+            seen_end: (0, Duration::from_secs(0)),
+            seen_inflation: (0, Duration::from_secs(0)),
+        }
+    }
+
+    /// Limits the time a single `end_frame_capture()` call may take on average.
+    pub fn end_frame_capture_budget<B: Into<Option<Duration>>>(mut self, budget: B) -> Self {
+        self.end_budget = budget.into();
+        self
+    }
+
+    /// Limits how much longer a captured frame may take than the uncaptured frames around it.
+    pub fn frame_inflation_budget<B: Into<Option<Duration>>>(mut self, budget: B) -> Self {
+        self.inflation_budget = budget.into();
+        self
+    }
+
+    /// Restores options once the overhead falls below `fraction` of the budget.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if `fraction` is not within `(0, 1]`.
+    pub fn headroom(mut self, fraction: f64) -> Self {
+        assert!(
+            fraction > 0.0 && fraction <= 1.0,
+            "Headroom must be in (0, 1]"
+        );
+        self.headroom = fraction;
+        self
+    }
+
+    /// Requires `samples` new measurements after every change before making the next one.
+    pub fn min_samples(mut self, samples: u32) -> Self {
+        self.min_samples = samples.max(1);
+        self
+    }
+
+    /// Sets the options to disable when over budget, in order.
+    pub fn ladder(mut self, options: &[CaptureOption]) -> Self {
+        self.ladder = options.to_vec();
+        self
+    }
+
+    /// Returns the options currently disabled by the governor, in the order they were disabled.
+    pub fn disabled_options(&self) -> &[CaptureOption] {
+        &self.disabled
+    }
+
+    /// Returns the estimated duration of `end_frame_capture()` with the current options.
+    pub fn end_frame_capture_estimate(&self) -> Option<Duration> {
+        self.end.value()
+    }
+
+    /// Returns the estimated frame time inflation of captured frames with the current options.
+    pub fn frame_inflation_estimate(&self) -> Option<Duration> {
+        self.inflation.value()
+    }
+
+    /// Records the duration of a call to `end_frame_capture()`.
+    pub fn record_end_frame_capture(&mut self, duration: Duration) {
+        self.end.record(duration);
+    }
+
+    /// Records how much longer a captured frame took than the uncaptured frames around it.
+    pub fn record_frame_inflation(&mut self, inflation: Duration) {
+        self.inflation.record(inflation);
+    }
+
+    /// Records the samples `profiler` has measured since the previous call.
+    ///
+    /// Only the combined mean of the new samples is known, so they are recorded as that many
+    /// samples of the mean.
+    pub fn observe(&mut self, profiler: &CaptureProfiler) {
+        let end = OverheadMetric::WallTime(CapturePhase::EndFrameCapture);
+        observe_metric(profiler, end, &mut self.seen_end, &mut self.end);
+        let inflation = OverheadMetric::FrameInflation;
+        observe_metric(
+            profiler,
+            inflation,
+            &mut self.seen_inflation,
+            &mut self.inflation,
+        );
+    }
+
+    /// Disables or restores at most one option, depending on the measured overhead.
+    ///
+    /// Returns the change made, if any.
+    pub fn update(&mut self, rd: &mut RenderDoc<V100>) -> Option<GovernorAction> {
+        let samples = self.end.samples.max(self.inflation.samples);
+        if samples < self.min_samples {
+            return None;
+        }
+
+        let over = self.end.exceeds(self.end_budget, 1.0)
+            || self.inflation.exceeds(self.inflation_budget, 1.0);
+        let under = !self.end.exceeds(self.end_budget, self.headroom)
+            && !self.inflation.exceeds(self.inflation_budget, self.headroom);
+
+        let action = if over {
+            if self.original.is_none() {
+                self.original = Some(self.snapshot(rd));
+            }
+
+            let original = self.original.unwrap_or_default();
+            let disabled = &self.disabled;
+            let next = self.ladder.iter().cloned().find(|&opt| {
+                !disabled.contains(&opt) && original.get(opt).map_or(false, |val| val != 0)
+            })?;
+
+            self.disabled.push(next);
+            GovernorAction::Downgraded(next)
+        } else if under {
+            GovernorAction::Restored(self.disabled.pop()?)
+        } else {
+            return None;
+        };
+
+        self.apply(rd);
+        self.end = Estimate::default();
+        self.inflation = Estimate::default();
+        Some(action)
+    }
+
+    /// Restores every option disabled by the governor and releases control over them.
+    ///
+    /// Returns the number of options which were restored.
+    pub fn restore_all(&mut self, rd: &mut RenderDoc<V100>) -> usize {
+        let restored = self.disabled.len();
+        self.disabled.clear();
+        self.apply(rd);
+        self.original = None;
+        restored
+    }
+
+    /// Returns the current values of the ladder options, before the governor changes any.
+    fn snapshot(&self, rd: &RenderDoc<V100>) -> CaptureProfile {
+        let current = CaptureProfile::snapshot(rd);
+        let mut original = CaptureProfile::new();
+        for &opt in self.ladder.iter() {
+            if let Some(val) = current.get(opt) {
+                original.set(opt, val);
+            }
+        }
+
+        original
+    }
+
+    /// Applies the original option values, with every option in `disabled` turned off.
+    fn apply(&self, rd: &mut RenderDoc<V100>) {
+        if let Some(mut profile) = self.original {
+            for &opt in self.disabled.iter() {
+                profile.set(opt, 0);
+            }
+
+            profile.apply(rd);
+        }
+    }
+}
+
+impl Default for OverheadGovernor {
+    fn default() -> Self {
+        OverheadGovernor::new()
+    }
+}
+
+/// Feeds the samples of `metric` recorded since `seen` into `estimate`.
+fn observe_metric(
+    profiler: &CaptureProfiler,
+    metric: OverheadMetric,
+    seen: &mut (u64, Duration),
+    estimate: &mut Estimate,
+) {
+    let (count, total) = profiler.total(metric);
+    let (seen_count, seen_total) = *seen;
+    *seen = (count, total);
+
+    // NOTE: The profiler may have been reset since the previous call.
+    let (new_count, new_total) =
+        match (count.checked_sub(seen_count), total.checked_sub(seen_total)) {
+            (Some(new_count), Some(new_total)) => (new_count, new_total),
+            _ => (count, total),
+        };
+
+    if new_count == 0 {
+        return;
+    }
+
+    let mean = Duration::from_secs_f64(new_total.as_secs_f64() / new_count as f64);
+    estimate.record_many(mean, new_count);
+}
+
+/// Exponentially weighted moving average of a duration.
+#[derive(Clone, Copy, Debug, Default)]
+struct Estimate {
+    secs: Option<f64>,
+    samples: u32,
+}
+
+impl Estimate {
+    fn record(&mut self, value: Duration) {
+        self.record_many(value, 1);
+    }
+
+    /// Records `n` samples of `value` at once, with the same result as calling `record()` `n`
+    /// times.
+    fn record_many(&mut self, value: Duration, n: u64) {
+        if n == 0 {
+            return;
+        }
+
+        // Every sample scales the weight of the previous estimate by `1 - EWMA_ALPHA`.
+        let value = value.as_secs_f64();
+        let weight = 1.0 - (1.0 - EWMA_ALPHA).powf(n as f64);
+        self.secs = Some(match self.secs {
+            Some(secs) => secs + weight * (value - secs),
+            None => value,
+        });
+        let n = n.min(u64::from(u32::max_value())) as u32;
+        self.samples = self.samples.saturating_add(n);
+    }
+
+    fn value(&self) -> Option<Duration> {
+        self.secs.map(Duration::from_secs_f64)
+    }
+
+    fn exceeds(&self, budget: Option<Duration>, fraction: f64) -> bool {
+        match (self.secs, budget) {
+            (Some(secs), Some(budget)) => secs > budget.as_secs_f64() * fraction,
+            _ => false,
+        }
+    }
+}
+
+#[cfg(test)]
+#[cfg(not(feature = "disabled"))]
+mod tests {
+    use super::*;
+    use crate::version::V141;
+
+    #[test]
+    fn downgrades_and_restores_in_ladder_order() {
+        let mut rd = RenderDoc::<V141>::isolated();
+        rd.set_capture_option_u32(CaptureOption::ApiValidation, 1);
+        rd.set_capture_option_u32(CaptureOption::CaptureCallstacks, 0);
+        rd.set_capture_option_u32(CaptureOption::RefAllResources, 1);
+        rd.set_capture_option_u32(CaptureOption::SaveAllInitials, 1);
+
+        let mut governor = OverheadGovernor::new()
+            .end_frame_capture_budget(Duration::from_millis(100))
+            .min_samples(2);
+        let feed = |governor: &mut OverheadGovernor, rd: &mut RenderDoc<V141>, ms| {
+            governor.record_end_frame_capture(Duration::from_millis(ms));
+            governor.record_end_frame_capture(Duration::from_millis(ms));
+            governor.update(rd)
+        };
+
+        let downgraded = GovernorAction::Downgraded;
+        assert_eq!(
+            feed(&mut governor, &mut rd, 300),
+            Some(downgraded(CaptureOption::ApiValidation))
+        );
+        assert_eq!(rd.get_capture_option_u32(CaptureOption::ApiValidation), 0);
+        // `CaptureCallstacks` is already off, so it is skipped.
+        assert_eq!(
+            feed(&mut governor, &mut rd, 300),
+            Some(downgraded(CaptureOption::RefAllResources))
+        );
+        assert_eq!(feed(&mut governor, &mut rd, 80), None);
+
+        let restored = feed(&mut governor, &mut rd, 20);
+        assert_eq!(
+            restored,
+            Some(GovernorAction::Restored(CaptureOption::RefAllResources))
+        );
+        assert_eq!(rd.get_capture_option_u32(CaptureOption::RefAllResources), 1);
+
+        assert_eq!(governor.restore_all(&mut rd), 1);
+        assert_eq!(rd.get_capture_option_u32(CaptureOption::ApiValidation), 1);
+    }
+
+    #[test]
+    fn many_samples_are_folded_at_once() {
+        let (mut one_by_one, mut folded) = (Estimate::default(), Estimate::default());
+        one_by_one.record(Duration::from_millis(10));
+        folded.record(Duration::from_millis(10));
+
+        for _ in 0..50 {
+            one_by_one.record(Duration::from_millis(4));
+        }
+        folded.record_many(Duration::from_millis(4), 50);
+        assert!((one_by_one.secs.unwrap() - folded.secs.unwrap()).abs() < 1e-12);
+        assert_eq!(one_by_one.samples, folded.samples);
+
+        folded.record_many(Duration::from_millis(1), u64::MAX);
+        assert!((folded.secs.unwrap() - 0.001).abs() < 1e-12);
+        assert_eq!(folded.samples, u32::max_value());
+    }
+}
@@ -9,6 +9,15 @@
 //! These bindings require that RenderDoc be installed on the target machine, with either
 //! `renderdoc.dll` or `librenderdoc.so` visible from your `$PATH`.
 //!
+//! Builds which must not pay for capture hooks can enable the `disabled` feature, which turns every
+//! `RenderDoc` method into a no-op at compile time and never loads the library. To make the same
+//! decision at runtime, use `RenderDoc::new_or_disabled()` instead.
+//!
+//! The `rdc` feature adds the [`rdc`] module for reading the metadata of capture files directly,
+//! without launching the replay tools.
+//!
+//! [`rdc`]: ./rdc/index.html
+//!
 //! For more details on how to use this API to integrate your game or renderer with the RenderDoc
 //! profiler, consult the upstream [in-application API][in-app] documentation.
 //!
@@ -20,24 +29,63 @@
 #[cfg(any(target_os = "macos", target_os = "ios"))]
 compile_error!("RenderDoc does not support this platform.");
 
+pub use self::anomaly::{Anomaly, AnomalyKind, AnomalyTrigger, FrameTimeStats};
+pub use self::captures::{CaptureWatcher, Captures, NewCaptures};
+pub use self::completion::{CaptureFuture, CompletedCapture, CompletionWatcher};
+#[cfg(feature = "zstd")]
+pub use self::compression::{CompressionPipeline, CompressionStats};
+pub use self::controller::{CaptureCommand, CaptureController, CaptureHandle};
+pub use self::dynamic::DynRenderDoc;
 pub use self::error::Error;
+pub use self::frame_capture::FrameCapture;
+pub use self::governor::{GovernorAction, OverheadGovernor};
 pub use self::handles::{DevicePointer, WindowHandle};
+pub use self::marshal::{CStrArg, OptCStrArg};
+pub use self::overhead::{CapturePhase, CaptureProfiler, OverheadMetric, OverheadSummary};
+pub use self::profile::CaptureProfile;
 pub use self::renderdoc::RenderDoc;
+pub use self::retention::{CaptureRetention, Eviction, RetainedCapture, RetentionUsage};
+pub use self::rolling_capture::{RollingCapture, RollingCaptureStats};
 pub use self::settings::{CaptureOption, InputButton, OverlayBits};
 pub use self::version::{
-    Entry, HasPrevious, Version, V100, V110, V111, V112, V120, V130, V140, V141,
+    Entry, HasPrevious, Version, VersionCode, V100, V110, V111, V112, V120, V130, V140, V141,
 };
+pub use self::worker::{CaptureWorker, CaptureWorkerStats, FinishedCapture, PendingCapture};
 
 use std::os::raw::c_ulonglong;
 
 #[cfg(windows)]
 use winapi::shared::guiddef::GUID;
 
+#[cfg(feature = "mock")]
+pub mod mock;
+#[cfg(feature = "rdc")]
+pub mod rdc;
+
+mod anomaly;
+mod backend;
+mod captures;
+mod completion;
+#[cfg(feature = "zstd")]
+mod compression;
+mod controller;
+mod dynamic;
 mod error;
+mod frame_capture;
+#[cfg_attr(feature = "disabled", allow(dead_code))]
+mod function_table;
+mod governor;
 mod handles;
+mod marshal;
+mod overhead;
+mod profile;
 mod renderdoc;
+mod retention;
+mod rolling_capture;
 mod settings;
+mod shadow;
 mod version;
+mod worker;
 
 /// Magic value used for when applications pass a path where shader debug information can be found
 /// to match up with a stripped shader.
@@ -0,0 +1,210 @@
+//! Conversion of arguments into their FFI representation without heap allocation.
+
+use std::borrow::Cow;
+use std::ffi::{CStr, CString, OsStr, OsString};
+use std::os::raw::c_char;
+use std::path::{Path, PathBuf};
+use std::ptr;
+
+/// Strings shorter than this, including the terminating NUL, are converted on the stack.
+const STACK_STRING_LEN: usize = 512;
+
+/// Key lists no longer than this are converted on the stack.
+const STACK_KEYS_LEN: usize = 64;
+
+mod sealed {
+    use std::ffi::CStr;
+
+    pub trait Sealed {
+        fn as_arg(&self) -> Arg<'_>;
+    }
+
+    pub trait OptSealed {
+        fn as_opt_arg(&self) -> Option<Arg<'_>>;
+    }
+
+    /// Borrowed view of a string argument.
+    #[derive(Debug)]
+    pub enum Arg<'a> {
+        /// Already NUL-terminated, passed through as-is.
+        Terminated(&'a CStr),
+        /// UTF-8 bytes without a terminator.
+        Bytes(&'a [u8]),
+        /// Not representable as UTF-8, which RenderDoc requires.
+        Invalid,
+    }
+}
+
+use self::sealed::{Arg, OptSealed, Sealed};
+
+/// String types which can be passed to RenderDoc without allocating.
+///
+/// This is implemented for string slices, paths and OS strings in their borrowed, owned, boxed and
+/// copy-on-write forms, as well as for C strings which are passed through to RenderDoc unchanged.
+/// Strings are converted on the stack, unless they are unusually long.
+pub trait CStrArg: Sealed {}
+
+impl<'a, T: CStrArg + ?Sized> Sealed for &'a T {
+    fn as_arg(&self) -> Arg<'_> {
+        (**self).as_arg()
+    }
+}
+
+impl<'a, T: CStrArg + ?Sized> CStrArg for &'a T {}
+
+macro_rules! impl_cstr_arg {
+    ($($ty:ty => |$s:ident| $arg:expr;)+) => {
+        $(
+            impl Sealed for $ty {
+                fn as_arg(&self) -> Arg<'_> {
+                    let $s = self;
+                    $arg
+                }
+            }
+
+            impl CStrArg for $ty {}
+        )+
+    };
+}
+
+impl_cstr_arg! {
+    str => |s| Arg::Bytes(s.as_bytes());
+    String => |s| Arg::Bytes(s.as_bytes());
+    Box<str> => |s| Arg::Bytes(s.as_bytes());
+    Cow<'_, str> => |s| Arg::Bytes(s.as_bytes());
+    CStr => |s| Arg::Terminated(s);
+    CString => |s| Arg::Terminated(s);
+    Box<CStr> => |s| Arg::Terminated(s);
+    Cow<'_, CStr> => |s| Arg::Terminated(s);
+    OsStr => |s| os_str(s);
+    OsString => |s| os_str(s);
+    Box<OsStr> => |s| os_str(s);
+    Cow<'_, OsStr> => |s| os_str(s);
+    Path => |s| os_str(s.as_os_str());
+    PathBuf => |s| os_str(s.as_os_str());
+    Box<Path> => |s| os_str(s.as_os_str());
+    Cow<'_, Path> => |s| os_str(s.as_os_str());
+}
+
+fn os_str(s: &OsStr) -> Arg<'_> {
+    s.to_str()
+        .map_or(Arg::Invalid, |s| Arg::Bytes(s.as_bytes()))
+}
+
+/// Optional string arguments, such as the capture path passed to `set_capture_file_comments()`.
+///
+/// This is implemented for every [`CStrArg`], and for `Option<&str>` so that `None` can be passed
+/// without naming a type.
+///
+/// [`CStrArg`]: ./trait.CStrArg.html
+pub trait OptCStrArg: OptSealed {}
+
+impl<T: CStrArg + ?Sized> OptSealed for T {
+    fn as_opt_arg(&self) -> Option<Arg<'_>> {
+        Some(self.as_arg())
+    }
+}
+
+impl<T: CStrArg + ?Sized> OptCStrArg for T {}
+
+impl<'a> OptSealed for Option<&'a str> {
+    fn as_opt_arg(&self) -> Option<Arg<'_>> {
+        self.map(|s| s.as_arg())
+    }
+}
+
+impl<'a> OptCStrArg for Option<&'a str> {}
+
+/// Calls `f` with `arg` as a NUL-terminated string, or with `None` if `arg` is not valid UTF-8 or
+/// contains an interior NUL byte.
+pub(crate) fn with_c_str<T, F, R>(arg: &T, f: F) -> R
+where
+    T: CStrArg + ?Sized,
+    F: FnOnce(Option<&CStr>) -> R,
+{
+    with_arg(arg.as_arg(), f)
+}
+
+fn with_arg<F, R>(arg: Arg<'_>, f: F) -> R
+where
+    F: FnOnce(Option<&CStr>) -> R,
+{
+    let bytes = match arg {
+        Arg::Terminated(s) => return f(Some(s)),
+        Arg::Bytes(bytes) => bytes,
+        Arg::Invalid => return f(None),
+    };
+
+    if bytes.len() < STACK_STRING_LEN {
+        let mut buf = [0u8; STACK_STRING_LEN];
+        buf[..bytes.len()].copy_from_slice(bytes);
+        f(CStr::from_bytes_with_nul(&buf[..=bytes.len()]).ok())
+    } else {
+        f(CString::new(bytes).ok().as_deref())
+    }
+}
+
+/// Calls `f` with a pointer to an optional NUL-terminated string, which is null for `None`.
+///
+/// Strings which cannot be converted are also passed as null.
+pub(crate) fn with_opt_c_str<T, F, R>(arg: &T, f: F) -> R
+where
+    T: OptCStrArg + ?Sized,
+    F: FnOnce(*const c_char) -> R,
+{
+    match arg.as_opt_arg() {
+        Some(arg) => with_arg(arg, |s| f(s.map_or(ptr::null(), CStr::as_ptr))),
+        None => f(ptr::null()),
+    }
+}
+
+/// Calls `f` with `keys` converted into a contiguous list of key codes.
+pub(crate) fn with_keys<I, F, R>(keys: &[I], f: F) -> R
+where
+    I: Into<crate::settings::InputButton> + Clone,
+    F: FnOnce(&mut [u32]) -> R,
+{
+    let convert = |k: &I| k.clone().into() as u32;
+
+    if keys.len() <= STACK_KEYS_LEN {
+        let mut buf = [0u32; STACK_KEYS_LEN];
+        for (dst, key) in buf.iter_mut().zip(keys) {
+            *dst = convert(key);
+        }
+        f(&mut buf[..keys.len()])
+    } else {
+        let mut buf: Vec<u32> = keys.iter().map(convert).collect();
+        f(&mut buf)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::settings::InputButton;
+
+    #[test]
+    fn long_and_invalid_strings() {
+        let long = "x".repeat(STACK_STRING_LEN * 2);
+        assert_eq!(
+            with_c_str(&long, |s| s.unwrap().to_bytes().len()),
+            long.len()
+        );
+        assert!(with_c_str("nul\0byte", |s| s.is_none()));
+        assert!(with_opt_c_str(&Some("nul\0byte"), |p| p.is_null()));
+        assert!(with_opt_c_str(&None::<&str>, |p| p.is_null()));
+        assert!(!with_opt_c_str(Path::new("/tmp/game"), |p| p.is_null()));
+
+        let boxed: Box<Path> = Path::new("/tmp/game").into();
+        let cow = Cow::Borrowed(Path::new("/tmp/game"));
+        assert_eq!(with_c_str(&boxed, |s| s.unwrap().to_bytes().len()), 9);
+        assert_eq!(with_c_str(&cow, |s| s.unwrap().to_bytes().len()), 9);
+
+        let mut rd = crate::renderdoc::RenderDoc::<crate::version::V141>::disabled();
+        rd.set_capture_file_path_template("nul\0byte");
+        rd.set_capture_file_comments(None, "nul\0byte");
+
+        let keys = vec![InputButton::F1; STACK_KEYS_LEN + 1];
+        assert_eq!(with_keys(&keys, |k| k.len()), keys.len());
+    }
+}
@@ -0,0 +1,502 @@
+//! In-process mock of the RenderDoc API, for testing and benchmarking without a GPU.
+//!
+//! The mock provides a complete `RENDERDOC_API_1_4_1` function table implemented in Rust. It keeps
+//! a count of every call made into it, simulates capture state (frame capturing, the list of
+//! completed captures, capture options and overlay bits) and can inject an artificial latency
+//! into any function to emulate the cost of a real RenderDoc installation.
+//!
+//! The mock is selected by `RenderDoc::new()` if either [`enable()`] has been called or the
+//! `RENDERDOC_RS_MOCK` environment variable is set to `1` before the API is first loaded.
+//! Alternatively, a handle can be created from [`entry()`] directly with `RenderDoc::from_raw()`.
+//!
+//! All state is process-global, just like with a real injected RenderDoc library.
+//!
+//! [`enable()`]: ./fn.enable.html
+//! [`entry()`]: ./fn.entry.html
+//!
+//! # Examples
+//!
+//! ```rust
+//! # use renderdoc::{Error, RenderDoc, V141};
+//! use renderdoc::mock::{self, Function};
+//!
+//! # fn main() -> Result<(), Error> {
+//! mock::enable();
+//!
+//! let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+//! renderdoc.start_frame_capture(std::ptr::null(), std::ptr::null());
+//! assert!(renderdoc.is_frame_capturing());
+//! renderdoc.end_frame_capture(std::ptr::null(), std::ptr::null());
+//!
+//! assert!(mock::call_count(Function::EndFrameCapture) >= 1);
+//! # Ok(())
+//! # }
+//! ```
+
+use std::env;
+use std::ffi::{CStr, CString};
+use std::io::Write;
+use std::os::raw::{c_char, c_int, c_void};
+use std::ptr;
+use std::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::{Duration, Instant, SystemTime, UNIX_EPOCH};
+
+use once_cell::sync::Lazy;
+use renderdoc_sys::{
+    RENDERDOC_API_1_4_1__bindgen_ty_1, RENDERDOC_API_1_4_1__bindgen_ty_2,
+    RENDERDOC_API_1_4_1__bindgen_ty_3, RENDERDOC_API_1_4_1__bindgen_ty_4,
+};
+
+use crate::version::{Entry, VersionCode};
+
+/// Environment variable which selects the mock when set to `1`.
+pub const ENV_VAR: &str = "RENDERDOC_RS_MOCK";
+
+/// Functions of the RenderDoc API implemented by the mock.
+#[allow(missing_docs)]
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum Function {
+    GetApiVersion,
+    SetCaptureOptionU32,
+    SetCaptureOptionF32,
+    GetCaptureOptionU32,
+    GetCaptureOptionF32,
+    SetFocusToggleKeys,
+    SetCaptureKeys,
+    GetOverlayBits,
+    MaskOverlayBits,
+    RemoveHooks,
+    UnloadCrashHandler,
+    SetCaptureFilePathTemplate,
+    GetCaptureFilePathTemplate,
+    GetNumCaptures,
+    GetCapture,
+    TriggerCapture,
+    IsTargetControlConnected,
+    LaunchReplayUi,
+    SetActiveWindow,
+    StartFrameCapture,
+    IsFrameCapturing,
+    EndFrameCapture,
+    TriggerMultiFrameCapture,
+    SetCaptureFileComments,
+    DiscardFrameCapture,
+    /// The `RENDERDOC_GetAPI` entry point itself.
+    GetApi,
+}
+
+const NUM_FUNCTIONS: usize = Function::GetApi as usize + 1;
+const NUM_OPTIONS: usize =
+    renderdoc_sys::eRENDERDOC_Option_AllowUnsupportedVendorExtensions as usize + 1;
+
+/// Option values of a freshly started RenderDoc instance, indexed by `CaptureOption`.
+const DEFAULT_OPTIONS: [u32; NUM_OPTIONS] = [1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 0];
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicU64 = AtomicU64::new(0);
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+static ENABLED_BY_ENV: Lazy<bool> = Lazy::new(|| env::var(ENV_VAR).map_or(false, |v| v == "1"));
+
+static CALLS: [AtomicU64; NUM_FUNCTIONS] = [ZERO; NUM_FUNCTIONS];
+static LATENCY_NANOS: [AtomicU64; NUM_FUNCTIONS] = [ZERO; NUM_FUNCTIONS];
+
+static CAPTURING: AtomicBool = AtomicBool::new(false);
+static OVERLAY_BITS: AtomicU32 = AtomicU32::new(renderdoc_sys::eRENDERDOC_Overlay_Default);
+static STATE: Lazy<Mutex<State>> = Lazy::new(|| Mutex::new(State::default()));
+
+static ENTRY: Entry = Entry {
+    GetAPIVersion: Some(get_api_version),
+    SetCaptureOptionU32: Some(set_capture_option_u32),
+    SetCaptureOptionF32: Some(set_capture_option_f32),
+    GetCaptureOptionU32: Some(get_capture_option_u32),
+    GetCaptureOptionF32: Some(get_capture_option_f32),
+    SetFocusToggleKeys: Some(set_focus_toggle_keys),
+    SetCaptureKeys: Some(set_capture_keys),
+    GetOverlayBits: Some(get_overlay_bits),
+    MaskOverlayBits: Some(mask_overlay_bits),
+    __bindgen_anon_1: RENDERDOC_API_1_4_1__bindgen_ty_1 {
+        RemoveHooks: Some(remove_hooks),
+    },
+    UnloadCrashHandler: Some(unload_crash_handler),
+    __bindgen_anon_2: RENDERDOC_API_1_4_1__bindgen_ty_2 {
+        SetCaptureFilePathTemplate: Some(set_capture_file_path_template),
+    },
+    __bindgen_anon_3: RENDERDOC_API_1_4_1__bindgen_ty_3 {
+        GetCaptureFilePathTemplate: Some(get_capture_file_path_template),
+    },
+    GetNumCaptures: Some(get_num_captures),
+    GetCapture: Some(get_capture),
+    TriggerCapture: Some(trigger_capture),
+    __bindgen_anon_4: RENDERDOC_API_1_4_1__bindgen_ty_4 {
+        IsTargetControlConnected: Some(is_target_control_connected),
+    },
+    LaunchReplayUI: Some(launch_replay_ui),
+    SetActiveWindow: Some(set_active_window),
+    StartFrameCapture: Some(start_frame_capture),
+    IsFrameCapturing: Some(is_frame_capturing),
+    EndFrameCapture: Some(end_frame_capture),
+    TriggerMultiFrameCapture: Some(trigger_multi_frame_capture),
+    SetCaptureFileComments: Some(set_capture_file_comments),
+    DiscardFrameCapture: Some(discard_frame_capture),
+};
+
+#[derive(Debug)]
+struct State {
+    options: [u32; NUM_OPTIONS],
+    path_template: Arc<CString>,
+    captures: Vec<Capture>,
+    next_frame: u64,
+}
+
+impl Default for State {
+    fn default() -> Self {
+        let template = env::temp_dir().join("RenderDoc").join("renderdoc_mock");
+        let template = template.into_os_string().into_string().unwrap_or_default();
+
+        State {
+            options: DEFAULT_OPTIONS,
+            path_template: Arc::new(CString::new(template).unwrap_or_default()),
+            captures: Vec::new(),
+            next_frame: 1,
+        }
+    }
+}
+
+impl State {
+    fn push_capture(&mut self) {
+        let frame = self.next_frame;
+        self.next_frame += 1;
+
+        let timestamp = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .map_or(0, |d| d.as_secs());
+
+        self.captures.push(Capture {
+            path_template: self.path_template.clone(),
+            frame,
+            timestamp,
+            comments: None,
+        });
+    }
+}
+
+/// A completed capture, stored compactly so that capturing every frame stays cheap.
+#[derive(Debug)]
+struct Capture {
+    path_template: Arc<CString>,
+    frame: u64,
+    timestamp: u64,
+    comments: Option<CString>,
+}
+
+impl Capture {
+    /// Writes the NUL-terminated path of the capture into `out`, if it is not null.
+    ///
+    /// Returns the length of the path, including the NUL terminator.
+    unsafe fn write_path(&self, out: *mut c_char) -> usize {
+        let mut suffix = [0u8; 32];
+        let suffix_len = {
+            let mut cursor = &mut suffix[..];
+            write!(cursor, "_frame{}.rdc\0", self.frame).expect("Suffix buffer too small");
+            32 - cursor.len()
+        };
+
+        let prefix = self.path_template.as_bytes();
+        if !out.is_null() {
+            let out = out as *mut u8;
+            ptr::copy_nonoverlapping(prefix.as_ptr(), out, prefix.len());
+            ptr::copy_nonoverlapping(suffix.as_ptr(), out.add(prefix.len()), suffix_len);
+        }
+
+        prefix.len() + suffix_len
+    }
+
+    /// Returns whether the capture is stored at `path`.
+    fn is_at(&self, path: &CStr) -> bool {
+        unsafe {
+            let mut buf = vec![0 as c_char; self.write_path(ptr::null_mut())];
+            self.write_path(buf.as_mut_ptr());
+            CStr::from_ptr(buf.as_ptr()) == path
+        }
+    }
+}
+
+/// Makes `RenderDoc::new()` load the mock instead of the real RenderDoc library.
+///
+/// This must be called before the RenderDoc API is loaded for the first time.
+pub fn enable() {
+    ENABLED.store(true, Ordering::SeqCst);
+}
+
+/// Returns whether the mock has been selected, either with `enable()` or through `ENV_VAR`.
+pub fn is_enabled() -> bool {
+    ENABLED.load(Ordering::SeqCst) || *ENABLED_BY_ENV
+}
+
+/// Returns the mock entry point, suitable for passing to `RenderDoc::from_raw()`.
+pub fn entry() -> *mut Entry {
+    &ENTRY as *const Entry as *mut Entry
+}
+
+/// Mock replacement for the `RENDERDOC_GetAPI` symbol.
+///
+/// # Safety
+///
+/// `out` must be a valid pointer.
+pub(crate) unsafe extern "C" fn get_api(version: VersionCode, out: *mut *mut c_void) -> i32 {
+    record(Function::GetApi);
+    if version <= VersionCode::V141 {
+        *out = entry() as *mut c_void;
+        1
+    } else {
+        0
+    }
+}
+
+/// Injects an artificial delay into every subsequent call of `function`.
+///
+/// The delay is implemented as a busy-wait so that it remains accurate for sub-millisecond
+/// durations.
+pub fn set_latency(function: Function, latency: Duration) {
+    let nanos = latency.as_secs() * 1_000_000_000 + u64::from(latency.subsec_nanos());
+    LATENCY_NANOS[function as usize].store(nanos, Ordering::Relaxed);
+}
+
+/// Returns the number of times `function` has been called since the last `reset()`.
+pub fn call_count(function: Function) -> u64 {
+    CALLS[function as usize].load(Ordering::Relaxed)
+}
+
+/// Serializes the unit tests which depend on global mock state, such as call counts or the path
+/// template, while it is held.
+#[cfg(all(test, not(feature = "disabled")))]
+pub(crate) fn lock_for_test() -> std::sync::MutexGuard<'static, ()> {
+    static LOCK: Lazy<Mutex<()>> = Lazy::new(|| Mutex::new(()));
+    LOCK.lock().unwrap_or_else(|e| e.into_inner())
+}
+
+/// Returns the comments attached to the capture at `index` with `SetCaptureFileComments`.
+pub fn capture_comments(index: usize) -> Option<String> {
+    let state = STATE.lock().unwrap();
+    let capture = state.captures.get(index)?;
+    capture
+        .comments
+        .as_ref()
+        .map(|c| c.to_string_lossy().into_owned())
+}
+
+/// Restores the mock to its initial state, clearing call counts, latencies and captures.
+///
+/// The path template previously returned by `GetCaptureFilePathTemplate` is invalidated, and the
+/// capture options and overlay bits cached by handles wrapping `entry()` are discarded.
+pub fn reset() {
+    for (calls, latency) in CALLS.iter().zip(LATENCY_NANOS.iter()) {
+        calls.store(0, Ordering::Relaxed);
+        latency.store(0, Ordering::Relaxed);
+    }
+
+    CAPTURING.store(false, Ordering::SeqCst);
+    OVERLAY_BITS.store(renderdoc_sys::eRENDERDOC_Overlay_Default, Ordering::SeqCst);
+    *STATE.lock().unwrap() = State::default();
+    crate::shadow::Shadow::of(entry()).clear();
+}
+
+/// Records a call to `function` and applies its configured latency.
+fn record(function: Function) {
+    CALLS[function as usize].fetch_add(1, Ordering::Relaxed);
+
+    let nanos = LATENCY_NANOS[function as usize].load(Ordering::Relaxed);
+    if nanos > 0 {
+        let start = Instant::now();
+        let latency = Duration::from_nanos(nanos);
+        while start.elapsed() < latency {}
+    }
+}
+
+unsafe extern "C" fn get_api_version(major: *mut c_int, minor: *mut c_int, patch: *mut c_int) {
+    record(Function::GetApiVersion);
+    *major = 1;
+    *minor = 4;
+    *patch = 1;
+}
+
+unsafe extern "C" fn set_capture_option_u32(opt: u32, val: u32) -> c_int {
+    record(Function::SetCaptureOptionU32);
+    match STATE.lock().unwrap().options.get_mut(opt as usize) {
+        Some(slot) => {
+            *slot = val;
+            1
+        }
+        None => 0,
+    }
+}
+
+unsafe extern "C" fn set_capture_option_f32(opt: u32, val: f32) -> c_int {
+    record(Function::SetCaptureOptionF32);
+    match STATE.lock().unwrap().options.get_mut(opt as usize) {
+        Some(slot) => {
+            *slot = val as u32;
+            1
+        }
+        None => 0,
+    }
+}
+
+unsafe extern "C" fn get_capture_option_u32(opt: u32) -> u32 {
+    record(Function::GetCaptureOptionU32);
+    let state = STATE.lock().unwrap();
+    state
+        .options
+        .get(opt as usize)
+        .cloned()
+        .unwrap_or(std::u32::MAX)
+}
+
+unsafe extern "C" fn get_capture_option_f32(opt: u32) -> f32 {
+    record(Function::GetCaptureOptionF32);
+    let state = STATE.lock().unwrap();
+    let val = state.options.get(opt as usize).map(|&v| v as f32);
+    val.unwrap_or(-std::f32::MAX)
+}
+
+unsafe extern "C" fn set_focus_toggle_keys(_keys: *mut u32, _num: c_int) {
+    record(Function::SetFocusToggleKeys);
+}
+
+unsafe extern "C" fn set_capture_keys(_keys: *mut u32, _num: c_int) {
+    record(Function::SetCaptureKeys);
+}
+
+unsafe extern "C" fn get_overlay_bits() -> u32 {
+    record(Function::GetOverlayBits);
+    OVERLAY_BITS.load(Ordering::SeqCst)
+}
+
+unsafe extern "C" fn mask_overlay_bits(and: u32, or: u32) {
+    record(Function::MaskOverlayBits);
+    let masked = (OVERLAY_BITS.load(Ordering::SeqCst) & and) | or;
+    OVERLAY_BITS.store(masked, Ordering::SeqCst);
+}
+
+unsafe extern "C" fn remove_hooks() {
+    record(Function::RemoveHooks);
+}
+
+unsafe extern "C" fn unload_crash_handler() {
+    record(Function::UnloadCrashHandler);
+}
+
+unsafe extern "C" fn set_capture_file_path_template(template: *const c_char) {
+    record(Function::SetCaptureFilePathTemplate);
+    if !template.is_null() {
+        STATE.lock().unwrap().path_template = Arc::new(CStr::from_ptr(template).to_owned());
+    }
+}
+
+unsafe extern "C" fn get_capture_file_path_template() -> *const c_char {
+    record(Function::GetCaptureFilePathTemplate);
+    STATE.lock().unwrap().path_template.as_ptr()
+}
+
+unsafe extern "C" fn get_num_captures() -> u32 {
+    record(Function::GetNumCaptures);
+    STATE.lock().unwrap().captures.len() as u32
+}
+
+unsafe extern "C" fn get_capture(
+    idx: u32,
+    filename: *mut c_char,
+    pathlength: *mut u32,
+    timestamp: *mut u64,
+) -> u32 {
+    record(Function::GetCapture);
+    let state = STATE.lock().unwrap();
+    let capture = match state.captures.get(idx as usize) {
+        Some(capture) => capture,
+        None => return 0,
+    };
+
+    let len = capture.write_path(filename);
+    if !pathlength.is_null() {
+        *pathlength = len as u32;
+    }
+
+    if !timestamp.is_null() {
+        *timestamp = capture.timestamp;
+    }
+
+    1
+}
+
+unsafe extern "C" fn trigger_capture() {
+    record(Function::TriggerCapture);
+    STATE.lock().unwrap().push_capture();
+}
+
+unsafe extern "C" fn is_target_control_connected() -> u32 {
+    record(Function::IsTargetControlConnected);
+    0
+}
+
+unsafe extern "C" fn launch_replay_ui(_connect: u32, _cmdline: *const c_char) -> u32 {
+    record(Function::LaunchReplayUi);
+    0
+}
+
+unsafe extern "C" fn set_active_window(_dev: *mut c_void, _win: *mut c_void) {
+    record(Function::SetActiveWindow);
+}
+
+unsafe extern "C" fn start_frame_capture(_dev: *mut c_void, _win: *mut c_void) {
+    record(Function::StartFrameCapture);
+    CAPTURING.store(true, Ordering::SeqCst);
+}
+
+unsafe extern "C" fn is_frame_capturing() -> u32 {
+    record(Function::IsFrameCapturing);
+    CAPTURING.load(Ordering::SeqCst) as u32
+}
+
+unsafe extern "C" fn end_frame_capture(_dev: *mut c_void, _win: *mut c_void) -> u32 {
+    record(Function::EndFrameCapture);
+    if CAPTURING.swap(false, Ordering::SeqCst) {
+        STATE.lock().unwrap().push_capture();
+        1
+    } else {
+        0
+    }
+}
+
+unsafe extern "C" fn trigger_multi_frame_capture(num_frames: u32) {
+    record(Function::TriggerMultiFrameCapture);
+    let mut state = STATE.lock().unwrap();
+    for _ in 0..num_frames {
+        state.push_capture();
+    }
+}
+
+unsafe extern "C" fn set_capture_file_comments(path: *const c_char, comments: *const c_char) {
+    record(Function::SetCaptureFileComments);
+    if comments.is_null() {
+        return;
+    }
+
+    let mut state = STATE.lock().unwrap();
+    let target = if path.is_null() {
+        state.captures.last_mut()
+    } else {
+        let path = CStr::from_ptr(path);
+        state.captures.iter_mut().find(|c| c.is_at(path))
+    };
+
+    if let Some(capture) = target {
+        capture.comments = Some(CStr::from_ptr(comments).to_owned());
+    }
+}
+
+unsafe extern "C" fn discard_frame_capture(_dev: *mut c_void, _win: *mut c_void) -> u32 {
+    record(Function::DiscardFrameCapture);
+    CAPTURING.swap(false, Ordering::SeqCst) as u32
+}
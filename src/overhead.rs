@@ -0,0 +1,699 @@
+//! Measurement of the frame time cost of RenderDoc captures.
+
+use std::cell::RefCell;
+use std::fmt::{self, Display, Formatter};
+use std::io::{self, Write};
+use std::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use std::sync::{Arc, Mutex, Weak};
+use std::thread;
+use std::time::{Duration, Instant};
+
+use crate::anomaly::{bucket_index, bucket_upper_bound, duration_as_micros, NUM_BUCKETS};
+use crate::handles::{DevicePointer, WindowHandle};
+use crate::renderdoc::RenderDoc;
+use crate::version::{V100, V140};
+
+/// Number of uncaptured frames on either side of a captured frame which form its baseline.
+const BASELINE_FRAMES: u32 = 8;
+
+static NEXT_PROFILER_ID: AtomicUsize = AtomicUsize::new(0);
+
+thread_local! {
+    /// Histograms owned by the current thread, for every profiler it has recorded into.
+    static LOCAL: RefCell<Vec<(usize, Weak<ThreadHistograms>)>> = RefCell::new(Vec::new());
+}
+
+/// A capture API call measured by a `CaptureProfiler`.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum CapturePhase {
+    /// `start_frame_capture()`.
+    StartFrameCapture,
+    /// `end_frame_capture()`, during which RenderDoc serializes the capture.
+    EndFrameCapture,
+    /// `trigger_capture()`.
+    TriggerCapture,
+    /// `discard_frame_capture()`.
+    DiscardFrameCapture,
+}
+
+impl CapturePhase {
+    const ALL: [CapturePhase; 4] = [
+        CapturePhase::StartFrameCapture,
+        CapturePhase::EndFrameCapture,
+        CapturePhase::TriggerCapture,
+        CapturePhase::DiscardFrameCapture,
+    ];
+
+    fn name(self) -> &'static str {
+        match self {
+            CapturePhase::StartFrameCapture => "start_frame_capture",
+            CapturePhase::EndFrameCapture => "end_frame_capture",
+            CapturePhase::TriggerCapture => "trigger_capture",
+            CapturePhase::DiscardFrameCapture => "discard_frame_capture",
+        }
+    }
+}
+
+/// A quantity recorded by a `CaptureProfiler`.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum OverheadMetric {
+    /// Wall-clock time spent in a capture call.
+    WallTime(CapturePhase),
+    /// CPU time consumed by the calling thread during a capture call.
+    ///
+    /// Only recorded on platforms which provide per-thread CPU clocks.
+    ThreadCpuTime(CapturePhase),
+    /// How much longer a captured frame took than the uncaptured frames around it.
+    FrameInflation,
+}
+
+impl OverheadMetric {
+    const COUNT: usize = CapturePhase::ALL.len() * 2 + 1;
+
+    fn index(self) -> usize {
+        match self {
+            OverheadMetric::WallTime(phase) => phase as usize,
+            OverheadMetric::ThreadCpuTime(phase) => CapturePhase::ALL.len() + phase as usize,
+            OverheadMetric::FrameInflation => Self::COUNT - 1,
+        }
+    }
+
+    fn from_index(index: usize) -> Self {
+        let phases = CapturePhase::ALL.len();
+        match index {
+            i if i < phases => OverheadMetric::WallTime(CapturePhase::ALL[i]),
+            i if i < phases * 2 => OverheadMetric::ThreadCpuTime(CapturePhase::ALL[i - phases]),
+            _ => OverheadMetric::FrameInflation,
+        }
+    }
+}
+
+impl Display for OverheadMetric {
+    fn fmt(&self, f: &mut Formatter) -> fmt::Result {
+        match *self {
+            OverheadMetric::WallTime(phase) => write!(f, "{}.wall", phase.name()),
+            OverheadMetric::ThreadCpuTime(phase) => write!(f, "{}.cpu", phase.name()),
+            OverheadMetric::FrameInflation => write!(f, "frame_inflation"),
+        }
+    }
+}
+
+/// Distribution of one `OverheadMetric`, as recorded on one thread or on all threads combined.
+///
+/// Percentiles are estimated from a histogram with a relative resolution of about 12%.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct OverheadSummary {
+    /// Name of the recording thread, or `"all"` for the combination of every thread.
+    pub thread: String,
+    /// The quantity being summarized.
+    pub metric: OverheadMetric,
+    /// Number of samples recorded.
+    pub count: u64,
+    /// Mean of all samples.
+    pub mean: Duration,
+    /// Estimated median.
+    pub p50: Duration,
+    /// Estimated 90th percentile.
+    pub p90: Duration,
+    /// Estimated 99th percentile.
+    pub p99: Duration,
+    /// Largest sample.
+    pub max: Duration,
+}
+
+/// Measures how much RenderDoc captures cost, broken down by capture call and thread.
+///
+/// Capture calls made through the profiler record their wall-clock time and the CPU time of the
+/// calling thread. Each thread records into its own histograms with relaxed atomic increments, so
+/// instrumented calls never contend on a lock. When [`on_frame()`] is called once per frame,
+/// frames during which a capture was active are also compared against the mean of the uncaptured
+/// frames just before and after them, which yields the frame time inflation caused by capturing.
+///
+/// Results can be inspected with [`summaries()`], or dumped with [`write_csv()`] and
+/// [`write_json()`]. Recording the same workload with different `CaptureOption`s, calling
+/// [`reset()`] in between, shows what each option costs.
+///
+/// [`on_frame()`]: #method.on_frame
+/// [`summaries()`]: #method.summaries
+/// [`write_csv()`]: #method.write_csv
+/// [`write_json()`]: #method.write_json
+/// [`reset()`]: #method.reset
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureOption, CaptureProfiler, Error, RenderDoc, V141};
+/// # use std::time::Instant;
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// renderdoc.set_capture_option_u32(CaptureOption::CaptureCallstacks, 1);
+/// let profiler = CaptureProfiler::new();
+///
+/// for frame in 0..1000 {
+///     let start = Instant::now();
+///     if frame % 100 == 50 {
+///         profiler.start_frame_capture(&mut renderdoc, std::ptr::null(), std::ptr::null());
+///         // Do some rendering here...
+///         profiler.end_frame_capture(&mut renderdoc, std::ptr::null(), std::ptr::null());
+///     } else {
+///         // Do some rendering here...
+///     }
+///     profiler.on_frame(start.elapsed());
+/// }
+///
+/// profiler.write_csv(std::io::stdout()).unwrap();
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct CaptureProfiler {
+    id: usize,
+    threads: Mutex<Vec<Arc<ThreadHistograms>>>,
+    frames: Mutex<FrameTracker>,
+    active: AtomicBool,
+    captured: AtomicBool,
+    triggered: AtomicBool,
+}
+
+impl CaptureProfiler {
+    /// Creates a new profiler without any samples.
+    pub fn new() -> Self {
+        CaptureProfiler {
+            id: NEXT_PROFILER_ID.fetch_add(1, Ordering::Relaxed),
+            threads: Mutex::new(Vec::new()),
+            frames: Mutex::new(FrameTracker::default()),
+            active: AtomicBool::new(false),
+            captured: AtomicBool::new(false),
+            triggered: AtomicBool::new(false),
+        }
+    }
+
+    /// Calls `f`, recording its duration as `phase` of a capture.
+    ///
+    /// This allows measuring capture calls made elsewhere, e.g. by a `CaptureWorker`.
+    pub fn measure<R, F: FnOnce() -> R>(&self, phase: CapturePhase, f: F) -> R {
+        let cpu_start = thread_cpu_time();
+        let start = Instant::now();
+        let result = f();
+        let wall = start.elapsed();
+        let cpu = match (cpu_start, thread_cpu_time()) {
+            (Some(start), Some(end)) => end.checked_sub(start),
+            _ => None,
+        };
+
+        self.with_local(|local| {
+            local.record(OverheadMetric::WallTime(phase), wall);
+            if let Some(cpu) = cpu {
+                local.record(OverheadMetric::ThreadCpuTime(phase), cpu);
+            }
+        });
+
+        result
+    }
+
+    /// Begins a frame capture, see `RenderDoc::start_frame_capture()`.
+    pub fn start_frame_capture<D>(&self, rd: &mut RenderDoc<V100>, dev: D, win: WindowHandle)
+    where
+        D: Into<DevicePointer>,
+    {
+        self.active.store(true, Ordering::Relaxed);
+        self.captured.store(true, Ordering::Relaxed);
+        self.measure(CapturePhase::StartFrameCapture, || {
+            rd.start_frame_capture(dev, win)
+        });
+    }
+
+    /// Ends the active frame capture, see `RenderDoc::end_frame_capture()`.
+    pub fn end_frame_capture<D>(&self, rd: &mut RenderDoc<V100>, dev: D, win: WindowHandle)
+    where
+        D: Into<DevicePointer>,
+    {
+        self.measure(CapturePhase::EndFrameCapture, || {
+            rd.end_frame_capture(dev, win)
+        });
+        self.active.store(false, Ordering::Relaxed);
+    }
+
+    /// Captures the next frame, see `RenderDoc::trigger_capture()`.
+    pub fn trigger_capture(&self, rd: &mut RenderDoc<V100>) {
+        self.triggered.store(true, Ordering::Relaxed);
+        self.measure(CapturePhase::TriggerCapture, || rd.trigger_capture());
+    }
+
+    /// Discards the active frame capture, see `RenderDoc::<V140>::discard_frame_capture()`.
+    pub fn discard_frame_capture<D>(
+        &self,
+        rd: &mut RenderDoc<V140>,
+        dev: D,
+        win: WindowHandle,
+    ) -> bool
+    where
+        D: Into<DevicePointer>,
+    {
+        let discarded = self.measure(CapturePhase::DiscardFrameCapture, || {
+            rd.discard_frame_capture(dev, win)
+        });
+        self.active.store(false, Ordering::Relaxed);
+        discarded
+    }
+
+    /// Records the duration of the frame which just finished.
+    ///
+    /// Frames during which a capture was active, or which follow a call to `trigger_capture()`,
+    /// are counted as captured. This should be called from a single thread, once per frame.
+    pub fn on_frame(&self, frame_time: Duration) {
+        let next =
+            self.active.load(Ordering::Relaxed) || self.triggered.swap(false, Ordering::Relaxed);
+        let captured = self.captured.swap(next, Ordering::Relaxed);
+
+        let finished = self.frames.lock().unwrap().record(frame_time, captured);
+        if let Some(inflation) = finished {
+            self.with_local(|local| local.record(OverheadMetric::FrameInflation, inflation));
+        }
+    }
+
+    /// Returns the distribution of every metric with at least one sample, for each thread and for
+    /// all threads combined.
+    pub fn summaries(&self) -> Vec<OverheadSummary> {
+        let threads = self.threads.lock().unwrap();
+        let mut summaries = Vec::new();
+
+        for index in 0..OverheadMetric::COUNT {
+            let metric = OverheadMetric::from_index(index);
+            let mut total = HistogramSnapshot::default();
+
+            for local in threads.iter() {
+                let snapshot = local.metrics[index].snapshot();
+                if snapshot.count > 0 {
+                    summaries.push(snapshot.summarize(&local.thread, metric));
+                    total.merge(&snapshot);
+                }
+            }
+
+            if total.count > 0 {
+                summaries.push(total.summarize("all", metric));
+            }
+        }
+
+        summaries
+    }
+
+    /// Returns the distribution of `metric` across all threads, if it has any samples.
+    pub fn summary(&self, metric: OverheadMetric) -> Option<OverheadSummary> {
+        let mut total = HistogramSnapshot::default();
+        for local in self.threads.lock().unwrap().iter() {
+            total.merge(&local.metrics[metric.index()].snapshot());
+        }
+
+        if total.count > 0 {
+            Some(total.summarize("all", metric))
+        } else {
+            None
+        }
+    }
+
+    /// Returns the number of samples of `metric` across all threads and their exact sum.
+    ///
+    /// Unlike `OverheadSummary::mean`, the sum is not rounded, so the difference between two calls
+    /// is exactly the sum of the samples recorded in between.
+    pub fn total(&self, metric: OverheadMetric) -> (u64, Duration) {
+        let (mut count, mut sum_micros) = (0, 0);
+        for local in self.threads.lock().unwrap().iter() {
+            let histogram = &local.metrics[metric.index()];
+            count += histogram.count.load(Ordering::Relaxed);
+            sum_micros += histogram.sum_micros.load(Ordering::Relaxed);
+        }
+
+        (count, Duration::from_micros(sum_micros))
+    }
+
+    /// Writes `summaries()` to `writer` as CSV, with durations in microseconds.
+    pub fn write_csv<W: Write>(&self, mut writer: W) -> io::Result<()> {
+        writeln!(
+            writer,
+            "thread,metric,count,mean_us,p50_us,p90_us,p99_us,max_us"
+        )?;
+        for s in self.summaries() {
+            writeln!(
+                writer,
+                "\"{}\",{},{},{},{},{},{},{}",
+                s.thread.replace('"', "\"\""),
+                s.metric,
+                s.count,
+                duration_as_micros(s.mean),
+                duration_as_micros(s.p50),
+                duration_as_micros(s.p90),
+                duration_as_micros(s.p99),
+                duration_as_micros(s.max),
+            )?;
+        }
+
+        Ok(())
+    }
+
+    /// Writes `summaries()` to `writer` as a JSON array, with durations in microseconds.
+    pub fn write_json<W: Write>(&self, mut writer: W) -> io::Result<()> {
+        write!(writer, "[")?;
+        for (i, s) in self.summaries().iter().enumerate() {
+            if i > 0 {
+                write!(writer, ",")?;
+            }
+
+            write!(writer, "{{\"thread\":")?;
+            write_json_string(&mut writer, &s.thread)?;
+            write!(
+                writer,
+                ",\"metric\":\"{}\",\"count\":{},\"mean_us\":{},\"p50_us\":{},\"p90_us\":{},\
+                 \"p99_us\":{},\"max_us\":{}}}",
+                s.metric,
+                s.count,
+                duration_as_micros(s.mean),
+                duration_as_micros(s.p50),
+                duration_as_micros(s.p90),
+                duration_as_micros(s.p99),
+                duration_as_micros(s.max),
+            )?;
+        }
+
+        writeln!(writer, "]")
+    }
+
+    /// Discards all samples recorded so far.
+    pub fn reset(&self) {
+        for local in self.threads.lock().unwrap().iter() {
+            for histogram in local.metrics.iter() {
+                histogram.clear();
+            }
+        }
+
+        *self.frames.lock().unwrap() = FrameTracker::default();
+    }
+
+    /// Calls `f` with the histograms of the current thread, registering them on first use.
+    fn with_local<F: FnOnce(&ThreadHistograms)>(&self, f: F) {
+        LOCAL.with(|cache| {
+            let mut cache = cache.borrow_mut();
+            let found = cache
+                .iter()
+                .find(|&&(id, _)| id == self.id)
+                .and_then(|(_, local)| local.upgrade());
+
+            let local = found.unwrap_or_else(|| {
+                cache.retain(|(_, local)| local.strong_count() > 0);
+                let local = Arc::new(ThreadHistograms::new());
+                self.threads.lock().unwrap().push(local.clone());
+                cache.push((self.id, Arc::downgrade(&local)));
+                local
+            });
+
+            f(&local);
+        })
+    }
+}
+
+impl Default for CaptureProfiler {
+    fn default() -> Self {
+        CaptureProfiler::new()
+    }
+}
+
+/// Histograms of every metric, written only by the thread which owns them.
+#[derive(Debug)]
+struct ThreadHistograms {
+    thread: String,
+    metrics: Vec<Histogram>,
+}
+
+impl ThreadHistograms {
+    fn new() -> Self {
+        let current = thread::current();
+        let thread = match current.name() {
+            Some(name) => name.to_string(),
+            None => format!("{:?}", current.id()),
+        };
+
+        ThreadHistograms {
+            thread,
+            metrics: (0..OverheadMetric::COUNT)
+                .map(|_| Histogram::new())
+                .collect(),
+        }
+    }
+
+    fn record(&self, metric: OverheadMetric, value: Duration) {
+        self.metrics[metric.index()].record(value);
+    }
+}
+
+/// Logarithmic histogram of durations in microseconds, using the same buckets as
+/// `FrameTimeStats`.
+#[derive(Debug)]
+struct Histogram {
+    buckets: Box<[AtomicU64]>,
+    count: AtomicU64,
+    sum_micros: AtomicU64,
+    max_micros: AtomicU64,
+}
+
+impl Histogram {
+    fn new() -> Self {
+        Histogram {
+            buckets: (0..NUM_BUCKETS).map(|_| AtomicU64::new(0)).collect(),
+            count: AtomicU64::new(0),
+            sum_micros: AtomicU64::new(0),
+            max_micros: AtomicU64::new(0),
+        }
+    }
+
+    fn record(&self, value: Duration) {
+        let micros = duration_as_micros(value);
+        self.buckets[bucket_index(micros)].fetch_add(1, Ordering::Relaxed);
+        self.count.fetch_add(1, Ordering::Relaxed);
+        self.sum_micros.fetch_add(micros, Ordering::Relaxed);
+        self.max_micros.fetch_max(micros, Ordering::Relaxed);
+    }
+
+    fn clear(&self) {
+        for bucket in self.buckets.iter() {
+            bucket.store(0, Ordering::Relaxed);
+        }
+
+        self.count.store(0, Ordering::Relaxed);
+        self.sum_micros.store(0, Ordering::Relaxed);
+        self.max_micros.store(0, Ordering::Relaxed);
+    }
+
+    fn snapshot(&self) -> HistogramSnapshot {
+        HistogramSnapshot {
+            buckets: self
+                .buckets
+                .iter()
+                .map(|b| b.load(Ordering::Relaxed))
+                .collect(),
+            count: self.count.load(Ordering::Relaxed),
+            sum_micros: self.sum_micros.load(Ordering::Relaxed),
+            max_micros: self.max_micros.load(Ordering::Relaxed),
+        }
+    }
+}
+
+#[derive(Default)]
+struct HistogramSnapshot {
+    buckets: Vec<u64>,
+    count: u64,
+    sum_micros: u64,
+    max_micros: u64,
+}
+
+impl HistogramSnapshot {
+    fn merge(&mut self, other: &HistogramSnapshot) {
+        if self.buckets.is_empty() {
+            self.buckets = vec![0; NUM_BUCKETS];
+        }
+
+        for (bucket, &count) in self.buckets.iter_mut().zip(other.buckets.iter()) {
+            *bucket += count;
+        }
+
+        self.count += other.count;
+        self.sum_micros += other.sum_micros;
+        self.max_micros = self.max_micros.max(other.max_micros);
+    }
+
+    fn percentile(&self, p: f64) -> Duration {
+        let rank = ((p / 100.0) * self.count as f64).ceil().max(1.0) as u64;
+        let mut seen = 0;
+        for (index, &count) in self.buckets.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                let upper = bucket_upper_bound(index).min(self.max_micros);
+                return Duration::from_micros(upper);
+            }
+        }
+
+        Duration::from_micros(self.max_micros)
+    }
+
+    fn summarize(&self, thread: &str, metric: OverheadMetric) -> OverheadSummary {
+        OverheadSummary {
+            thread: thread.to_string(),
+            metric,
+            count: self.count,
+            mean: Duration::from_micros(self.sum_micros / self.count.max(1)),
+            p50: self.percentile(50.0),
+            p90: self.percentile(90.0),
+            p99: self.percentile(99.0),
+            max: Duration::from_micros(self.max_micros),
+        }
+    }
+}
+
+/// Compares captured frames against the uncaptured frames around them.
+#[derive(Debug, Default)]
+struct FrameTracker {
+    recent: [Duration; BASELINE_FRAMES as usize],
+    recent_len: u32,
+    next: usize,
+    pending: Option<CapturedFrame>,
+}
+
+#[derive(Debug)]
+struct CapturedFrame {
+    frame_time: Duration,
+    baseline_sum: Duration,
+    baseline_len: u32,
+    frames_after: u32,
+}
+
+impl FrameTracker {
+    /// Records a frame, returning the inflation of a captured frame once its baseline is known.
+    fn record(&mut self, frame_time: Duration, captured: bool) -> Option<Duration> {
+        if captured {
+            let finished = self.pending.take().and_then(CapturedFrame::inflation);
+            let len = self.recent_len as usize;
+            self.pending = Some(CapturedFrame {
+                frame_time,
+                baseline_sum: self.recent[..len].iter().sum(),
+                baseline_len: self.recent_len,
+                frames_after: 0,
+            });
+            return finished;
+        }
+
+        self.recent[self.next] = frame_time;
+        self.next = (self.next + 1) % self.recent.len();
+        self.recent_len = (self.recent_len + 1).min(BASELINE_FRAMES);
+
+        let pending = self.pending.as_mut()?;
+        pending.baseline_sum += frame_time;
+        pending.baseline_len += 1;
+        pending.frames_after += 1;
+        if pending.frames_after < BASELINE_FRAMES {
+            return None;
+        }
+
+        self.pending.take().and_then(CapturedFrame::inflation)
+    }
+}
+
+impl CapturedFrame {
+    fn inflation(self) -> Option<Duration> {
+        if self.baseline_len == 0 {
+            return None;
+        }
+
+        let baseline = self.baseline_sum / self.baseline_len;
+        Some(self.frame_time.checked_sub(baseline).unwrap_or_default())
+    }
+}
+
+/// Writes `s` as a quoted JSON string.
+fn write_json_string<W: Write>(writer: &mut W, s: &str) -> io::Result<()> {
+    write!(writer, "\"")?;
+    for c in s.chars() {
+        match c {
+            '"' => write!(writer, "\\\"")?,
+            '\\' => write!(writer, "\\\\")?,
+            c if c.is_control() => write!(writer, "\\u{:04x}", c as u32)?,
+            c => write!(writer, "{}", c)?,
+        }
+    }
+    write!(writer, "\"")
+}
+
+/// Returns the CPU time consumed by the current thread so far.
+#[cfg(unix)]
+fn thread_cpu_time() -> Option<Duration> {
+    let mut ts: libc::timespec = unsafe { std::mem::zeroed() };
+    if unsafe { libc::clock_gettime(libc::CLOCK_THREAD_CPUTIME_ID, &mut ts) } == 0 {
+        Some(Duration::new(ts.tv_sec as u64, ts.tv_nsec as u32))
+    } else {
+        None
+    }
+}
+
+/// Returns the CPU time consumed by the current thread so far.
+#[cfg(windows)]
+fn thread_cpu_time() -> Option<Duration> {
+    use winapi::shared::minwindef::FILETIME;
+    use winapi::um::processthreadsapi::{GetCurrentThread, GetThreadTimes};
+
+    let ticks = |t: FILETIME| (u64::from(t.dwHighDateTime) << 32) | u64::from(t.dwLowDateTime);
+    unsafe {
+        let mut creation: FILETIME = std::mem::zeroed();
+        let mut exit: FILETIME = std::mem::zeroed();
+        let mut kernel: FILETIME = std::mem::zeroed();
+        let mut user: FILETIME = std::mem::zeroed();
+        let thread = GetCurrentThread();
+        if GetThreadTimes(thread, &mut creation, &mut exit, &mut kernel, &mut user) != 0 {
+            // NOTE: `FILETIME` counts in units of 100 nanoseconds.
+            Some(Duration::from_nanos((ticks(kernel) + ticks(user)) * 100))
+        } else {
+            None
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::version::V141;
+    use std::ptr;
+
+    #[test]
+    fn captured_frames_are_compared_to_their_neighbours() {
+        let mut renderdoc = RenderDoc::<V141>::disabled();
+        let profiler = CaptureProfiler::new();
+        let frame = Duration::from_millis(10);
+
+        for _ in 0..BASELINE_FRAMES {
+            profiler.on_frame(frame);
+        }
+
+        profiler.start_frame_capture(&mut renderdoc, ptr::null(), ptr::null());
+        profiler.end_frame_capture(&mut renderdoc, ptr::null(), ptr::null());
+        profiler.on_frame(frame * 3);
+        assert!(profiler.summary(OverheadMetric::FrameInflation).is_none());
+
+        for _ in 0..BASELINE_FRAMES {
+            profiler.on_frame(frame);
+        }
+
+        let inflation = profiler.summary(OverheadMetric::FrameInflation).unwrap();
+        assert_eq!(inflation.count, 1);
+        assert_eq!(inflation.max, frame * 2);
+
+        let phase = OverheadMetric::WallTime(CapturePhase::EndFrameCapture);
+        assert_eq!(profiler.summary(phase).unwrap().count, 1);
+
+        let mut csv = Vec::new();
+        profiler.write_csv(&mut csv).unwrap();
+        assert_eq!(
+            String::from_utf8(csv).unwrap().lines().count(),
+            1 + profiler.summaries().len()
+        );
+
+        profiler.reset();
+        assert!(profiler.summaries().is_empty());
+    }
+}
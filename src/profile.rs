@@ -0,0 +1,176 @@
+//! Sets of capture options which can be switched between at runtime.
+
+use crate::backend::Backend;
+use crate::renderdoc::RenderDoc;
+use crate::settings::CaptureOption;
+use crate::version::V100;
+
+/// A set of values for some or all `CaptureOption`s, applied to RenderDoc in one go.
+///
+/// Options which are not part of a profile are left untouched when it is applied. Applying a
+/// profile only calls into RenderDoc for options whose value actually changes, as tracked across
+/// every `RenderDoc` handle in the process, so switching between profiles every frame is cheap.
+/// If options may have been changed by the replay UI, call `refresh()` on the handle first.
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureOption, CaptureProfile, Error, RenderDoc, V141};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// let original = CaptureProfile::snapshot(&renderdoc);
+///
+/// let full_fidelity = CaptureProfile::new()
+///     .with(CaptureOption::ApiValidation, 1)
+///     .with(CaptureOption::CaptureCallstacks, 1)
+///     .with(CaptureOption::RefAllResources, 1)
+///     .with(CaptureOption::SaveAllInitials, 1)
+///     .with(CaptureOption::CaptureAllCmdLists, 1);
+///
+/// full_fidelity.apply(&mut renderdoc);
+/// renderdoc.trigger_capture();
+/// // Render the frame to be captured here...
+///
+/// original.apply(&mut renderdoc);
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct CaptureProfile {
+    values: [u32; CaptureOption::ALL.len()],
+    present: u16,
+}
+
+impl CaptureProfile {
+    /// Creates a new profile which does not contain any options.
+    pub fn new() -> Self {
+        CaptureProfile::default()
+    }
+
+    /// Creates a profile containing the current value of every option supported by the library.
+    ///
+    /// Values already known to `renderdoc` are not read from the library again.
+    pub fn snapshot(renderdoc: &RenderDoc<V100>) -> Self {
+        let mut profile = CaptureProfile::new();
+
+        for &opt in CaptureOption::ALL.iter() {
+            let val = match renderdoc.shadow().option(opt) {
+                Some(val) => val,
+                None => match unsafe { renderdoc.table().get_capture_option_u32(opt as u32) } {
+                    // Options newer than the loaded library are reported as invalid.
+                    std::u32::MAX => continue,
+                    val => {
+                        renderdoc.shadow().set_option(opt, val);
+                        val
+                    }
+                },
+            };
+
+            profile.set(opt, val);
+        }
+
+        profile
+    }
+
+    /// Applies every option in this profile to `renderdoc`, returning the number of options which
+    /// were changed.
+    ///
+    /// Options whose current value is known to match the profile are skipped, including values
+    /// set through other handles. Options which the library rejects, such as those newer than the
+    /// loaded library, are left unchanged.
+    pub fn apply(&self, renderdoc: &mut RenderDoc<V100>) -> usize {
+        let mut changed = 0;
+
+        for (opt, val) in self.iter() {
+            if renderdoc.shadow().option(opt) == Some(val) {
+                continue;
+            }
+
+            if unsafe { renderdoc.table().set_capture_option_u32(opt as u32, val) } == 1 {
+                renderdoc.shadow().set_option(opt, val);
+                changed += 1;
+            }
+        }
+
+        changed
+    }
+
+    /// Returns the value of `opt` in this profile, if present.
+    pub fn get(&self, opt: CaptureOption) -> Option<u32> {
+        if self.present & (1 << opt.index()) != 0 {
+            Some(self.values[opt.index()])
+        } else {
+            None
+        }
+    }
+
+    /// Sets the value of `opt` in this profile.
+    ///
+    /// Every option except `CaptureOption::DelayForDebugger` is a boolean, so any non-zero value
+    /// is stored as 1.
+    pub fn set(&mut self, opt: CaptureOption, val: u32) {
+        self.values[opt.index()] = opt.stored_u32(val);
+        self.present |= 1 << opt.index();
+    }
+
+    /// Sets the value of `opt` in this profile, returning the modified profile.
+    pub fn with(mut self, opt: CaptureOption, val: u32) -> Self {
+        self.set(opt, val);
+        self
+    }
+
+    /// Removes `opt` from this profile, so that applying it leaves the option unchanged.
+    pub fn remove(&mut self, opt: CaptureOption) {
+        self.values[opt.index()] = 0;
+        self.present &= !(1 << opt.index());
+    }
+
+    /// Returns an iterator over the options in this profile and their values.
+    pub fn iter(&self) -> impl Iterator<Item = (CaptureOption, u32)> + '_ {
+        CaptureOption::ALL
+            .iter()
+            .filter_map(move |&opt| self.get(opt).map(|val| (opt, val)))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn profile_values_are_normalized() {
+        let mut profile = CaptureProfile::new()
+            .with(CaptureOption::CaptureCallstacks, 5)
+            .with(CaptureOption::DelayForDebugger, 5);
+        assert_eq!(profile.get(CaptureOption::CaptureCallstacks), Some(1));
+        assert_eq!(profile.get(CaptureOption::DelayForDebugger), Some(5));
+        assert_eq!(profile.get(CaptureOption::RefAllResources), None);
+
+        profile.remove(CaptureOption::DelayForDebugger);
+        assert_eq!(
+            profile,
+            CaptureProfile::new().with(CaptureOption::CaptureCallstacks, 1)
+        );
+    }
+
+    #[test]
+    #[cfg(not(feature = "disabled"))]
+    fn apply_skips_unchanged_options() {
+        let mut renderdoc = RenderDoc::<crate::version::V141>::isolated();
+        let profile = CaptureProfile::new()
+            .with(CaptureOption::CaptureCallstacks, 1)
+            .with(CaptureOption::RefAllResources, 1);
+
+        assert_eq!(profile.apply(&mut renderdoc), 2);
+        assert_eq!(profile.apply(&mut renderdoc), 0);
+
+        renderdoc.set_capture_option_u32(CaptureOption::RefAllResources, 0);
+        assert_eq!(profile.apply(&mut renderdoc), 1);
+
+        // Changes made through another handle are seen, so the profile is applied again.
+        let mut other = renderdoc.duplicate();
+        other.set_capture_option_u32(CaptureOption::CaptureCallstacks, 0);
+        assert_eq!(profile.apply(&mut renderdoc), 1);
+        assert_eq!(profile.apply(&mut other), 0);
+    }
+}
@@ -0,0 +1,600 @@
+//! Read-only access to the metadata of RDC capture files.
+//!
+//! Capture files are memory-mapped and parsed lazily, so reading the header and section table of
+//! even a multi-gigabyte capture only touches the few pages holding them. Section contents are
+//! never read unless requested, either streamed with a [`SectionReader`] or decompressed in
+//! parallel with a [`SectionDecoder`].
+//!
+//! [`SectionReader`]: ./struct.SectionReader.html
+//! [`SectionDecoder`]: ./struct.SectionDecoder.html
+//!
+//! Only available with the `rdc` feature.
+//!
+//! # Examples
+//!
+//! ```rust,no_run
+//! # use renderdoc::rdc::{RdcFile, SectionType};
+//! # fn main() -> std::io::Result<()> {
+//! let capture = RdcFile::open("my_captures/example_frame123.rdc")?;
+//! println!("{} capture from RenderDoc {}", capture.driver_name(), capture.program_version());
+//!
+//! for section in capture.sections() {
+//!     println!("{:?}: {} bytes", section.section_type(), section.uncompressed_len());
+//! }
+//!
+//! if let Some(comments) = capture.comments() {
+//!     println!("Comments: {}", comments);
+//! }
+//! # Ok(())
+//! # }
+//! ```
+
+use std::borrow::Cow;
+use std::convert::TryInto;
+use std::fs::File;
+use std::io::{self, Read};
+use std::ops::Range;
+use std::path::Path;
+use std::str;
+use std::sync::Arc;
+
+use bitflags::bitflags;
+use memmap2::Mmap;
+
+pub use self::decode::{SectionDecoder, SectionReader, SectionThroughput};
+
+mod decode;
+
+/// Magic number at the start of every capture file, `RDOC` as a little-endian 64-bit integer.
+const MAGIC: u64 = 0x434f_4452;
+
+/// Size of the fixed part of the file header.
+const FILE_HEADER_LEN: usize = 32;
+
+/// Size of the fixed part of the thumbnail header.
+const THUMBNAIL_HEADER_LEN: usize = 8;
+
+/// Size of the fixed part of the capture metadata.
+const METADATA_HEADER_LEN: usize = 13;
+
+/// Kind of data stored in a section of a capture file.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum SectionType {
+    /// The serialized frame capture itself.
+    FrameCapture,
+    /// Database of resolved callstack symbols.
+    ResolveDatabase,
+    /// Event bookmarks added in the replay UI.
+    Bookmarks,
+    /// Capture comments, as set with `set_capture_file_comments()`.
+    Notes,
+    /// Custom resource names added in the replay UI.
+    ResourceRenames,
+    /// An AMD Radeon GPU Profiler profile.
+    AmdRgpProfile,
+    /// Full resolution, lossless thumbnail of the captured frame.
+    ExtendedThumbnail,
+    /// Diagnostic log of the captured application.
+    EmbeddedLogfile,
+    /// Shaders edited in the replay UI.
+    EditedShaders,
+    /// Embedded D3D12 core runtime.
+    D3D12Core,
+    /// Embedded D3D12 SDK layers.
+    D3D12SdkLayers,
+    /// A section type not known to this library.
+    Other(u32),
+}
+
+impl SectionType {
+    fn from_raw(raw: u32) -> Self {
+        match raw {
+            1 => SectionType::FrameCapture,
+            2 => SectionType::ResolveDatabase,
+            3 => SectionType::Bookmarks,
+            4 => SectionType::Notes,
+            5 => SectionType::ResourceRenames,
+            6 => SectionType::AmdRgpProfile,
+            7 => SectionType::ExtendedThumbnail,
+            8 => SectionType::EmbeddedLogfile,
+            9 => SectionType::EditedShaders,
+            10 => SectionType::D3D12Core,
+            11 => SectionType::D3D12SdkLayers,
+            other => SectionType::Other(other),
+        }
+    }
+}
+
+bitflags! {
+    /// Bit flags describing how a section is stored.
+    pub struct SectionFlags: u32 {
+        /// The section was written as text rather than binary.
+        const ASCII_STORED = 0x1;
+        /// The section contents are compressed with LZ4.
+        const LZ4_COMPRESSED = 0x2;
+        /// The section contents are compressed with zstd.
+        const ZSTD_COMPRESSED = 0x4;
+    }
+}
+
+/// An entry in the section table of a capture file.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct Section {
+    section_type: SectionType,
+    name: String,
+    version: u64,
+    flags: SectionFlags,
+    data: Range<usize>,
+    uncompressed_len: u64,
+}
+
+impl Section {
+    /// Returns the kind of data stored in the section.
+    pub fn section_type(&self) -> SectionType {
+        self.section_type
+    }
+
+    /// Returns the name of the section.
+    pub fn name(&self) -> &str {
+        &self.name
+    }
+
+    /// Returns the version of the section's format.
+    pub fn version(&self) -> u64 {
+        self.version
+    }
+
+    /// Returns how the section is stored.
+    pub fn flags(&self) -> SectionFlags {
+        self.flags
+    }
+
+    /// Returns the offset of the section contents from the start of the file.
+    pub fn offset(&self) -> u64 {
+        self.data.start as u64
+    }
+
+    /// Returns the size of the section contents as stored in the file.
+    pub fn compressed_len(&self) -> u64 {
+        self.data.len() as u64
+    }
+
+    /// Returns the size of the section contents once decompressed.
+    pub fn uncompressed_len(&self) -> u64 {
+        self.uncompressed_len
+    }
+
+    /// Returns whether the section contents are compressed.
+    pub fn is_compressed(&self) -> bool {
+        self.flags
+            .intersects(SectionFlags::LZ4_COMPRESSED | SectionFlags::ZSTD_COMPRESSED)
+    }
+}
+
+/// The thumbnail embedded in the header of a capture file.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub struct Thumbnail<'a> {
+    width: u16,
+    height: u16,
+    data: &'a [u8],
+}
+
+impl<'a> Thumbnail<'a> {
+    /// Returns the width of the thumbnail in pixels.
+    pub fn width(&self) -> u16 {
+        self.width
+    }
+
+    /// Returns the height of the thumbnail in pixels.
+    pub fn height(&self) -> u16 {
+        self.height
+    }
+
+    /// Returns the JPEG-encoded thumbnail image.
+    pub fn data(&self) -> &'a [u8] {
+        self.data
+    }
+}
+
+/// A capture file opened for reading its metadata.
+#[derive(Debug)]
+pub struct RdcFile {
+    data: Arc<Data>,
+    version: u32,
+    program_version: Range<usize>,
+    thumbnail: Option<(u16, u16, Range<usize>)>,
+    machine_ident: u64,
+    driver_id: u32,
+    driver_name: Range<usize>,
+    sections: Vec<Section>,
+}
+
+impl RdcFile {
+    /// Memory-maps the capture file at `path` and parses its header and section table.
+    ///
+    /// The file must not be modified while it is open.
+    pub fn open<P: AsRef<Path>>(path: P) -> io::Result<Self> {
+        let file = File::open(path)?;
+        if file.metadata()?.len() < FILE_HEADER_LEN as u64 {
+            return Err(invalid("File is too short for a capture"));
+        }
+
+        // NOTE: Safe as long as the file is not truncated while mapped, which RenderDoc never
+        // does to finished captures.
+        let map = unsafe { Mmap::map(&file)? };
+        RdcFile::parse(Data::Mapped(map))
+    }
+
+    /// Parses a capture file already held in memory.
+    pub fn from_bytes(bytes: Vec<u8>) -> io::Result<Self> {
+        RdcFile::parse(Data::Owned(bytes))
+    }
+
+    /// Returns the version of the container format.
+    pub fn version(&self) -> u32 {
+        self.version
+    }
+
+    /// Returns the version of RenderDoc which wrote the capture.
+    pub fn program_version(&self) -> &str {
+        self.str_at(&self.program_version)
+    }
+
+    /// Returns the thumbnail of the captured frame, if one was saved.
+    pub fn thumbnail(&self) -> Option<Thumbnail<'_>> {
+        self.thumbnail
+            .as_ref()
+            .map(|&(width, height, ref data)| Thumbnail {
+                width,
+                height,
+                data: &self.bytes()[data.clone()],
+            })
+    }
+
+    /// Returns an identifier of the machine the capture was made on.
+    pub fn machine_ident(&self) -> u64 {
+        self.machine_ident
+    }
+
+    /// Returns RenderDoc's identifier of the graphics API driver which was captured.
+    pub fn driver_id(&self) -> u32 {
+        self.driver_id
+    }
+
+    /// Returns the name of the graphics API driver which was captured, such as `Vulkan`.
+    pub fn driver_name(&self) -> &str {
+        self.str_at(&self.driver_name)
+    }
+
+    /// Returns the section table of the capture, in file order.
+    pub fn sections(&self) -> &[Section] {
+        &self.sections
+    }
+
+    /// Returns the first section of the given type, if present.
+    pub fn section(&self, section_type: SectionType) -> Option<&Section> {
+        self.sections
+            .iter()
+            .find(|s| s.section_type == section_type)
+    }
+
+    /// Returns the contents of `section` exactly as stored in the file, possibly compressed.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if `section` does not belong to this file.
+    pub fn raw_section(&self, section: &Section) -> &[u8] {
+        &self.bytes()[section.data.clone()]
+    }
+
+    /// Returns a reader streaming the decompressed contents of `section`.
+    ///
+    /// # Panics
+    ///
+    /// This method will panic if `section` does not belong to this file.
+    pub fn read_section(&self, section: &Section) -> SectionReader<'_> {
+        SectionReader::new(self.raw_section(section), section)
+    }
+
+    /// Returns the capture comments set with `set_capture_file_comments()`, if present.
+    ///
+    /// Returns `None` if the capture has no comments, or if they are compressed with a codec
+    /// whose feature is not enabled.
+    pub fn comments(&self) -> Option<Cow<'_, str>> {
+        let notes = self.section(SectionType::Notes)?;
+        if !notes.is_compressed() {
+            let raw = self.raw_section(notes);
+            return Some(String::from_utf8_lossy(until_nul(raw)));
+        }
+
+        let mut raw = Vec::new();
+        self.read_section(notes).read_to_end(&mut raw).ok()?;
+        Some(Cow::Owned(
+            String::from_utf8_lossy(until_nul(&raw)).into_owned(),
+        ))
+    }
+
+    fn parse(data: Data) -> io::Result<Self> {
+        let bytes = data.as_slice();
+        let mut reader = Reader::new(bytes);
+
+        if reader.u64()? != MAGIC {
+            return Err(invalid("Missing RDOC magic number"));
+        }
+
+        let version = reader.u32()?;
+        let header_len = reader.u32()? as usize;
+        let program_version = reader.range(16)?;
+
+        let width = reader.u16()?;
+        let height = reader.u16()?;
+        let thumbnail_len = reader.u32()? as usize;
+        let thumbnail_data = reader.range(thumbnail_len)?;
+        let thumbnail = if thumbnail_len > 0 {
+            Some((width, height, thumbnail_data))
+        } else {
+            None
+        };
+
+        let machine_ident = reader.u64()?;
+        let driver_id = reader.u32()?;
+        let driver_name_len = reader.u8()? as usize;
+        let driver_name = reader.range(driver_name_len)?;
+
+        let fixed_len = FILE_HEADER_LEN + THUMBNAIL_HEADER_LEN + METADATA_HEADER_LEN;
+        if header_len < fixed_len + thumbnail_len + driver_name_len {
+            return Err(invalid("Header length is too short"));
+        }
+
+        let mut sections = Vec::new();
+        reader.seek(header_len)?;
+        while !reader.is_empty() {
+            sections.push(reader.section()?);
+        }
+
+        Ok(RdcFile {
+            data: Arc::new(data),
+            version,
+            program_version,
+            thumbnail,
+            machine_ident,
+            driver_id,
+            driver_name,
+            sections,
+        })
+    }
+
+    fn bytes(&self) -> &[u8] {
+        self.data.as_slice()
+    }
+
+    /// Returns the NUL-terminated string within `range`, or an empty string if it is not UTF-8.
+    fn str_at(&self, range: &Range<usize>) -> &str {
+        str::from_utf8(until_nul(&self.bytes()[range.clone()])).unwrap_or_default()
+    }
+}
+
+/// Backing storage of an `RdcFile`.
+#[derive(Debug)]
+enum Data {
+    Mapped(Mmap),
+    Owned(Vec<u8>),
+}
+
+impl Data {
+    fn as_slice(&self) -> &[u8] {
+        match *self {
+            Data::Mapped(ref map) => map,
+            Data::Owned(ref vec) => vec,
+        }
+    }
+}
+
+/// Bounds-checked little-endian cursor over the contents of a capture file.
+struct Reader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Reader<'a> {
+    fn new(bytes: &'a [u8]) -> Self {
+        Reader { bytes, pos: 0 }
+    }
+
+    fn is_empty(&self) -> bool {
+        self.pos >= self.bytes.len()
+    }
+
+    fn seek(&mut self, pos: usize) -> io::Result<()> {
+        if pos > self.bytes.len() {
+            return Err(invalid("Offset is past the end of the file"));
+        }
+
+        self.pos = pos;
+        Ok(())
+    }
+
+    fn range(&mut self, len: usize) -> io::Result<Range<usize>> {
+        let end = self
+            .pos
+            .checked_add(len)
+            .filter(|&end| end <= self.bytes.len())
+            .ok_or_else(|| invalid("Unexpected end of file"))?;
+
+        let range = self.pos..end;
+        self.pos = end;
+        Ok(range)
+    }
+
+    fn take(&mut self, len: usize) -> io::Result<&'a [u8]> {
+        let range = self.range(len)?;
+        Ok(&self.bytes[range])
+    }
+
+    fn u8(&mut self) -> io::Result<u8> {
+        Ok(self.take(1)?[0])
+    }
+
+    fn u16(&mut self) -> io::Result<u16> {
+        Ok(u16::from_le_bytes(self.take(2)?.try_into().unwrap()))
+    }
+
+    fn u32(&mut self) -> io::Result<u32> {
+        Ok(u32::from_le_bytes(self.take(4)?.try_into().unwrap()))
+    }
+
+    fn u64(&mut self) -> io::Result<u64> {
+        Ok(u64::from_le_bytes(self.take(8)?.try_into().unwrap()))
+    }
+
+    /// Reads a section header, skipping over the section contents.
+    fn section(&mut self) -> io::Result<Section> {
+        match self.u8()? {
+            0 => self.binary_section(),
+            b'A' => self.ascii_section(),
+            _ => Err(invalid("Unknown section header")),
+        }
+    }
+
+    fn binary_section(&mut self) -> io::Result<Section> {
+        self.take(3)?;
+        let section_type = SectionType::from_raw(self.u32()?);
+        let compressed_len = self.u64()?;
+        let uncompressed_len = self.u64()?;
+        let version = self.u64()?;
+        let flags = SectionFlags::from_bits_truncate(self.u32()?);
+        let name_len = self.u32()? as usize;
+        let name = until_nul(self.take(name_len)?);
+
+        let len = usize_from(compressed_len)?;
+        Ok(Section {
+            section_type,
+            name: String::from_utf8_lossy(name).into_owned(),
+            version,
+            flags,
+            data: self.range(len)?,
+            uncompressed_len,
+        })
+    }
+
+    /// Reads a text section header, made of newline-terminated type, length, version and name.
+    fn ascii_section(&mut self) -> io::Result<Section> {
+        self.line()?;
+        let section_type = SectionType::from_raw(self.number()? as u32);
+        let len = self.number()?;
+        let version = self.number()?;
+        let name = String::from_utf8_lossy(self.line()?).into_owned();
+
+        Ok(Section {
+            section_type,
+            name,
+            version,
+            flags: SectionFlags::ASCII_STORED,
+            data: self.range(usize_from(len)?)?,
+            uncompressed_len: len,
+        })
+    }
+
+    fn line(&mut self) -> io::Result<&'a [u8]> {
+        let rest = &self.bytes[self.pos..];
+        let len = rest
+            .iter()
+            .position(|&b| b == b'\n')
+            .ok_or_else(|| invalid("Unterminated section header"))?;
+
+        let line = self.take(len)?;
+        self.pos += 1;
+        Ok(line)
+    }
+
+    fn number(&mut self) -> io::Result<u64> {
+        str::from_utf8(self.line()?)
+            .ok()
+            .and_then(|s| s.trim().parse().ok())
+            .ok_or_else(|| invalid("Malformed section header"))
+    }
+}
+
+/// Returns `raw` up to its first NUL byte, if any.
+fn until_nul(raw: &[u8]) -> &[u8] {
+    raw.split(|&b| b == 0).next().unwrap_or_default()
+}
+
+fn usize_from(len: u64) -> io::Result<usize> {
+    len.try_into()
+        .map_err(|_| invalid("Section is too large for this platform"))
+}
+
+fn invalid(msg: &'static str) -> io::Error {
+    io::Error::new(io::ErrorKind::InvalidData, msg)
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Writes a capture file header with a 3 byte thumbnail and a `Vulkan` driver.
+    pub(super) fn header() -> Vec<u8> {
+        let mut file = Vec::new();
+        file.extend_from_slice(&MAGIC.to_le_bytes());
+        file.extend_from_slice(&0x102u32.to_le_bytes());
+        file.extend_from_slice(&(32u32 + 8 + 3 + 13 + 6).to_le_bytes());
+        file.extend_from_slice(b"v1.15\0\0\0\0\0\0\0\0\0\0\0");
+        file.extend_from_slice(&[4, 0, 2, 0, 3, 0, 0, 0, 0xff, 0xd8, 0xff]);
+        file.extend_from_slice(&7u64.to_le_bytes());
+        file.extend_from_slice(&2u32.to_le_bytes());
+        file.push(6);
+        file.extend_from_slice(b"Vulkan");
+        file
+    }
+
+    /// Writes a binary section holding `data`, which decompresses to `uncompressed_len` bytes.
+    pub(super) fn section(
+        out: &mut Vec<u8>,
+        section_type: u32,
+        flags: u32,
+        name: &str,
+        data: &[u8],
+        uncompressed_len: usize,
+    ) {
+        out.extend_from_slice(&[0, 0, 0, 0]);
+        out.extend_from_slice(&section_type.to_le_bytes());
+        out.extend_from_slice(&(data.len() as u64).to_le_bytes());
+        out.extend_from_slice(&(uncompressed_len as u64).to_le_bytes());
+        out.extend_from_slice(&1u64.to_le_bytes());
+        out.extend_from_slice(&flags.to_le_bytes());
+        out.extend_from_slice(&(name.len() as u32 + 1).to_le_bytes());
+        out.extend_from_slice(name.as_bytes());
+        out.push(0);
+        out.extend_from_slice(data);
+    }
+
+    #[test]
+    fn parses_header_and_sections() {
+        let mut file = header();
+        let frame = "renderdoc/internal/framecapture";
+        section(&mut file, 1, 0x4, frame, &[1; 100], 200);
+        let notes = b"Flickering shadows\0";
+        section(&mut file, 4, 0, "renderdoc/ui/notes", notes, notes.len());
+
+        let rdc = RdcFile::from_bytes(file).unwrap();
+        assert_eq!((rdc.version(), rdc.program_version()), (0x102, "v1.15"));
+        assert_eq!((rdc.driver_id(), rdc.driver_name()), (2, "Vulkan"));
+        let thumbnail = rdc.thumbnail().unwrap();
+        assert_eq!((thumbnail.width(), thumbnail.height()), (4, 2));
+        assert_eq!(thumbnail.data(), &[0xff, 0xd8, 0xff]);
+
+        let frame = rdc.section(SectionType::FrameCapture).unwrap();
+        assert_eq!(frame.flags(), SectionFlags::ZSTD_COMPRESSED);
+        assert_eq!(
+            (frame.compressed_len(), frame.uncompressed_len()),
+            (100, 200)
+        );
+        assert_eq!(rdc.raw_section(frame), &[1; 100][..]);
+        assert_eq!(rdc.comments().unwrap(), "Flickering shadows");
+
+        let mut truncated = rdc.bytes().to_vec();
+        truncated.pop();
+        assert!(RdcFile::from_bytes(truncated).is_err());
+    }
+}
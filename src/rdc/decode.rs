@@ -0,0 +1,617 @@
+//! On-demand decompression of capture file sections.
+
+use std::collections::VecDeque;
+use std::convert::TryInto;
+#[cfg(feature = "zstd")]
+use std::fmt;
+use std::io::{self, Read};
+use std::ops::Range;
+use std::sync::mpsc::{self, Receiver, Sender};
+use std::sync::{Arc, Mutex};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant};
+
+use super::{invalid, Data, RdcFile, Section, SectionFlags, SectionType};
+
+/// Size of the uncompressed pages RenderDoc compresses LZ4 sections in.
+#[cfg(feature = "lz4")]
+const LZ4_PAGE_LEN: usize = 64 * 1024;
+
+/// Size of the uncompressed pages RenderDoc compresses zstd sections in.
+#[cfg(feature = "zstd")]
+const ZSTD_PAGE_LEN: usize = 128 * 1024;
+
+/// Upper bound of the compression ratio assumed when reserving the output of a section, so that a
+/// corrupt uncompressed length cannot cause a huge allocation up front.
+const MAX_RESERVE_RATIO: usize = 8;
+
+/// Number of pages which may be in flight per worker thread, bounding the memory held by pages
+/// decoded ahead of the one being copied out.
+const PAGES_PER_THREAD: usize = 2;
+
+/// How long decompressing a section took, for sizing the machines processing captures.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub struct SectionThroughput {
+    /// The kind of section which was decompressed.
+    pub section_type: SectionType,
+    /// Number of bytes read from the file.
+    pub compressed_bytes: u64,
+    /// Number of bytes after decompression.
+    pub uncompressed_bytes: u64,
+    /// Wall-clock time spent decompressing.
+    pub elapsed: Duration,
+}
+
+impl SectionThroughput {
+    /// Returns the number of decompressed bytes produced per second, or `None` if no time was
+    /// measured.
+    pub fn bytes_per_sec(&self) -> Option<f64> {
+        let secs = self.elapsed.as_secs_f64();
+        if secs > 0.0 {
+            Some(self.uncompressed_bytes as f64 / secs)
+        } else {
+            None
+        }
+    }
+
+    fn add(&mut self, other: &SectionThroughput) {
+        self.compressed_bytes += other.compressed_bytes;
+        self.uncompressed_bytes += other.uncompressed_bytes;
+        self.elapsed += other.elapsed;
+    }
+}
+
+/// Compression codec of a section.
+#[derive(Clone, Copy, Debug, Eq, PartialEq)]
+enum Codec {
+    Stored,
+    Lz4,
+    Zstd,
+}
+
+impl Codec {
+    fn of(section: &Section) -> Self {
+        if section.flags.contains(SectionFlags::ZSTD_COMPRESSED) {
+            Codec::Zstd
+        } else if section.flags.contains(SectionFlags::LZ4_COMPRESSED) {
+            Codec::Lz4
+        } else {
+            Codec::Stored
+        }
+    }
+}
+
+/// Streams the decompressed contents of a section, one page at a time.
+///
+/// Compressed sections are stored by RenderDoc as a sequence of pages, each prefixed with its
+/// compressed size. Only the page being read is decompressed, into a buffer which is reused for
+/// every page. Decompressing LZ4 sections requires the `lz4` feature, and zstd sections the
+/// `zstd` feature; reading a section without the required feature fails with an error.
+///
+/// This `struct` is created by the [`read_section()`] method on `RdcFile`.
+///
+/// [`read_section()`]: ./struct.RdcFile.html#method.read_section
+#[derive(Debug)]
+pub struct SectionReader<'a> {
+    raw: &'a [u8],
+    pos: usize,
+    codec: Codec,
+    page: Vec<u8>,
+    page_pos: usize,
+    /// The previous page, which LZ4 pages are compressed against.
+    #[cfg(feature = "lz4")]
+    previous: Vec<u8>,
+    #[cfg(feature = "zstd")]
+    zstd: ZstdContext,
+}
+
+impl<'a> SectionReader<'a> {
+    pub(super) fn new(raw: &'a [u8], section: &Section) -> Self {
+        SectionReader {
+            raw,
+            pos: 0,
+            codec: Codec::of(section),
+            page: Vec::new(),
+            page_pos: 0,
+            #[cfg(feature = "lz4")]
+            previous: Vec::new(),
+            #[cfg(feature = "zstd")]
+            zstd: ZstdContext::default(),
+        }
+    }
+
+    /// Decompresses the next page into `self.page`, returning `false` at the end of the section.
+    fn next_page(&mut self) -> io::Result<bool> {
+        let input = match next_page(self.raw, &mut self.pos)? {
+            Some(input) => &self.raw[input],
+            None => return Ok(false),
+        };
+
+        self.page_pos = 0;
+        let decoded = match self.codec {
+            Codec::Stored => unreachable!("Stored sections are not paged"),
+            #[cfg(feature = "lz4")]
+            Codec::Lz4 => {
+                std::mem::swap(&mut self.page, &mut self.previous);
+                decode_lz4_page(input, &self.previous, &mut self.page)
+            }
+            #[cfg(feature = "zstd")]
+            Codec::Zstd => self.zstd.decode_page(input, &mut self.page),
+            #[allow(unreachable_patterns)]
+            codec => {
+                let _ = input;
+                Err(unsupported(codec))
+            }
+        };
+
+        decoded.map(|()| true)
+    }
+}
+
+impl<'a> Read for SectionReader<'a> {
+    fn read(&mut self, buf: &mut [u8]) -> io::Result<usize> {
+        if self.codec == Codec::Stored {
+            let len = buf.len().min(self.raw.len() - self.pos);
+            buf[..len].copy_from_slice(&self.raw[self.pos..self.pos + len]);
+            self.pos += len;
+            return Ok(len);
+        }
+
+        while self.page_pos == self.page.len() {
+            if !self.next_page()? {
+                return Ok(0);
+            }
+        }
+
+        let len = buf.len().min(self.page.len() - self.page_pos);
+        buf[..len].copy_from_slice(&self.page[self.page_pos..self.page_pos + len]);
+        self.page_pos += len;
+        Ok(len)
+    }
+}
+
+/// Decompresses whole sections, spreading the pages of zstd sections across worker threads.
+///
+/// RenderDoc compresses every page of a zstd section as an independent frame, so those pages are
+/// decompressed in parallel and copied out in order. Each page of an LZ4 section is compressed
+/// against the previous one, so LZ4 sections are decompressed sequentially on the calling thread.
+///
+/// Worker threads are spawned on first use and keep their zstd decompression context, as does the
+/// decoder itself for sections decompressed on the calling thread. Page buffers are recycled
+/// between pages and calls, so decompressing many sections in a row does not allocate once the
+/// buffers have grown. The throughput of every call is returned, and totals per
+/// section type are kept.
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::rdc::{RdcFile, SectionDecoder, SectionType};
+/// # fn main() -> std::io::Result<()> {
+/// let capture = RdcFile::open("my_captures/example_frame123.rdc")?;
+/// let mut decoder = SectionDecoder::new(8);
+///
+/// if let Some(section) = capture.section(SectionType::FrameCapture) {
+///     let mut frame = Vec::new();
+///     let stats = decoder.decompress_into(&capture, section, &mut frame)?;
+///     println!("{:.0} MB/s", stats.bytes_per_sec().unwrap_or(0.0) / 1e6);
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct SectionDecoder {
+    threads: usize,
+    pool: Option<Pool>,
+    pages: Vec<Range<usize>>,
+    free: Vec<Vec<u8>>,
+    #[cfg(feature = "zstd")]
+    zstd: ZstdContext,
+    totals: Vec<SectionThroughput>,
+}
+
+impl SectionDecoder {
+    /// Creates a decoder which decompresses zstd sections on `threads` worker threads.
+    ///
+    /// With a single thread, every section is decompressed on the calling thread instead.
+    pub fn new(threads: usize) -> Self {
+        SectionDecoder {
+            threads: threads.max(1),
+            pool: None,
+            pages: Vec::new(),
+            free: Vec::new(),
+            #[cfg(feature = "zstd")]
+            zstd: ZstdContext::default(),
+            totals: Vec::new(),
+        }
+    }
+
+    /// Decompresses `section` of `rdc`, returning its contents.
+    pub fn decompress(&mut self, rdc: &RdcFile, section: &Section) -> io::Result<Vec<u8>> {
+        let mut out = Vec::new();
+        self.decompress_into(rdc, section, &mut out)?;
+        Ok(out)
+    }
+
+    /// Decompresses `section` of `rdc`, replacing the contents of `out`.
+    ///
+    /// Reusing `out` between calls avoids reallocating it for every section.
+    pub fn decompress_into(
+        &mut self,
+        rdc: &RdcFile,
+        section: &Section,
+        out: &mut Vec<u8>,
+    ) -> io::Result<SectionThroughput> {
+        let start = Instant::now();
+        let raw = rdc.raw_section(section);
+        out.clear();
+        let uncompressed_len: usize = section.uncompressed_len.try_into().unwrap_or(usize::MAX);
+        out.reserve(uncompressed_len.min(raw.len().saturating_mul(MAX_RESERVE_RATIO)));
+
+        let codec = Codec::of(section);
+        if codec == Codec::Zstd && self.threads > 1 {
+            self.pages.clear();
+            let mut pos = 0;
+            while let Some(page) = next_page(raw, &mut pos)? {
+                let offset = section.data.start;
+                self.pages.push(offset + page.start..offset + page.end);
+            }
+
+            self.decompress_parallel(&rdc.data, out)?;
+        } else {
+            let mut reader = SectionReader::new(raw, section);
+            if let Some(page) = self.free.pop() {
+                reader.page = page;
+            }
+            #[cfg(feature = "zstd")]
+            std::mem::swap(&mut reader.zstd, &mut self.zstd);
+
+            let result = reader.read_to_end(out);
+            self.free.push(reader.page);
+            #[cfg(feature = "zstd")]
+            std::mem::swap(&mut reader.zstd, &mut self.zstd);
+            result?;
+        }
+
+        let throughput = SectionThroughput {
+            section_type: section.section_type,
+            compressed_bytes: raw.len() as u64,
+            uncompressed_bytes: out.len() as u64,
+            elapsed: start.elapsed(),
+        };
+
+        match self
+            .totals
+            .iter_mut()
+            .find(|t| t.section_type == section.section_type)
+        {
+            Some(total) => total.add(&throughput),
+            None => self.totals.push(throughput),
+        }
+
+        Ok(throughput)
+    }
+
+    /// Returns the combined throughput of every section of the given type decompressed so far.
+    pub fn throughput(&self, section_type: SectionType) -> Option<SectionThroughput> {
+        self.totals
+            .iter()
+            .find(|t| t.section_type == section_type)
+            .cloned()
+    }
+
+    /// Decompresses the zstd pages at `self.pages` of `data` on the worker pool, in order.
+    fn decompress_parallel(&mut self, data: &Arc<Data>, out: &mut Vec<u8>) -> io::Result<()> {
+        let threads = self.threads;
+        let pool = self.pool.get_or_insert_with(|| Pool::spawn(threads));
+        let (reply, replies) = mpsc::channel();
+
+        let max_in_flight = threads * PAGES_PER_THREAD;
+        let mut window: VecDeque<Option<Vec<u8>>> = VecDeque::with_capacity(max_in_flight);
+        let (mut submitted, mut written) = (0, 0);
+
+        while written < self.pages.len() {
+            while submitted < self.pages.len() && submitted - written < max_in_flight {
+                let job = Job {
+                    data: data.clone(),
+                    input: self.pages[submitted].clone(),
+                    index: submitted,
+                    buf: self.free.pop().unwrap_or_default(),
+                    reply: reply.clone(),
+                };
+
+                pool.sender
+                    .as_ref()
+                    .unwrap()
+                    .send(job)
+                    .map_err(|_| exited())?;
+                window.push_back(None);
+                submitted += 1;
+            }
+
+            let (index, result, buf) = replies.recv().map_err(|_| exited())?;
+            result?;
+            window[index - written] = Some(buf);
+
+            while let Some(Some(_)) = window.front() {
+                let page = window.pop_front().unwrap().unwrap();
+                out.extend_from_slice(&page);
+                self.free.push(page);
+                written += 1;
+            }
+        }
+
+        Ok(())
+    }
+}
+
+/// Request to decompress a single zstd page, sent to the worker pool.
+struct Job {
+    data: Arc<Data>,
+    input: Range<usize>,
+    index: usize,
+    buf: Vec<u8>,
+    reply: Sender<(usize, io::Result<()>, Vec<u8>)>,
+}
+
+/// Worker threads decompressing zstd pages.
+#[derive(Debug)]
+struct Pool {
+    sender: Option<Sender<Job>>,
+    threads: Vec<JoinHandle<()>>,
+}
+
+impl Pool {
+    fn spawn(threads: usize) -> Self {
+        let (sender, receiver) = mpsc::channel::<Job>();
+        let receiver = Arc::new(Mutex::new(receiver));
+
+        let threads = (0..threads)
+            .map(|i| {
+                let receiver = receiver.clone();
+                thread::Builder::new()
+                    .name(format!("renderdoc-rdc-decode-{}", i))
+                    .spawn(move || run_worker(&receiver))
+                    .expect("Failed to spawn decompression thread")
+            })
+            .collect();
+
+        Pool {
+            sender: Some(sender),
+            threads,
+        }
+    }
+}
+
+impl Drop for Pool {
+    fn drop(&mut self) {
+        drop(self.sender.take());
+        for thread in self.threads.drain(..) {
+            let _ = thread.join();
+        }
+    }
+}
+
+fn run_worker(receiver: &Mutex<Receiver<Job>>) {
+    #[cfg(feature = "zstd")]
+    let mut zstd = ZstdContext::default();
+
+    loop {
+        let Job {
+            data,
+            input,
+            index,
+            mut buf,
+            reply,
+        } = match receiver.lock().unwrap().recv() {
+            Ok(job) => job,
+            Err(_) => return,
+        };
+
+        let input = &data.as_slice()[input];
+        #[cfg(feature = "zstd")]
+        let result = zstd.decode_page(input, &mut buf);
+        #[cfg(not(feature = "zstd"))]
+        let result = {
+            let _ = (input, &mut buf);
+            Err(unsupported(Codec::Zstd))
+        };
+
+        // NOTE: The caller stops listening after the first failed page.
+        let _ = reply.send((index, result, buf));
+    }
+}
+
+/// Returns the position of the next page within `raw`, advancing `pos` past it.
+fn next_page(raw: &[u8], pos: &mut usize) -> io::Result<Option<Range<usize>>> {
+    if *pos >= raw.len() {
+        return Ok(None);
+    }
+
+    let len_bytes = raw
+        .get(*pos..*pos + 4)
+        .ok_or_else(|| invalid("Truncated page header"))?;
+    let len = u32::from_le_bytes(len_bytes.try_into().unwrap()) as usize;
+
+    let start = *pos + 4;
+    let end = start
+        .checked_add(len)
+        .filter(|&end| end <= raw.len())
+        .ok_or_else(|| invalid("Truncated page"))?;
+
+    *pos = end;
+    Ok(Some(start..end))
+}
+
+#[cfg(feature = "lz4")]
+fn decode_lz4_page(input: &[u8], previous: &[u8], out: &mut Vec<u8>) -> io::Result<()> {
+    out.resize(LZ4_PAGE_LEN, 0);
+    let len = lz4_flex::block::decompress_into_with_dict(input, out, previous)
+        .map_err(|_| invalid("Corrupt LZ4 page"))?;
+    out.truncate(len);
+    Ok(())
+}
+
+/// zstd decompression context, created on first use and reused for every following page.
+#[cfg(feature = "zstd")]
+#[derive(Default)]
+struct ZstdContext(Option<zstd::bulk::Decompressor<'static>>);
+
+#[cfg(feature = "zstd")]
+impl ZstdContext {
+    fn decode_page(&mut self, input: &[u8], out: &mut Vec<u8>) -> io::Result<()> {
+        if self.0.is_none() {
+            self.0 = Some(zstd::bulk::Decompressor::new()?);
+        }
+
+        out.resize(ZSTD_PAGE_LEN, 0);
+        let len = self
+            .0
+            .as_mut()
+            .unwrap()
+            .decompress_to_buffer(input, &mut out[..])?;
+        out.truncate(len);
+        Ok(())
+    }
+}
+
+#[cfg(feature = "zstd")]
+impl fmt::Debug for ZstdContext {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_tuple("ZstdContext").finish()
+    }
+}
+
+fn unsupported(codec: Codec) -> io::Error {
+    let msg = match codec {
+        Codec::Lz4 => "LZ4 sections require the `lz4` feature",
+        _ => "zstd sections require the `zstd` feature",
+    };
+
+    io::Error::new(io::ErrorKind::Other, msg)
+}
+
+fn exited() -> io::Error {
+    io::Error::new(io::ErrorKind::Other, "Decompression thread exited")
+}
+
+#[cfg(test)]
+#[cfg(any(feature = "lz4", feature = "zstd"))]
+mod tests {
+    use super::super::tests::{header, section};
+    use super::*;
+
+    #[test]
+    #[cfg(feature = "zstd")]
+    fn parallel_and_streamed_contents_match() {
+        use std::io::Write;
+
+        let contents: Vec<u8> = (0..300_000u32).map(|i| (i / 700) as u8).collect();
+        let mut paged = Vec::new();
+        for page in contents.chunks(64 * 1024) {
+            let mut encoder = zstd::stream::write::Encoder::new(Vec::new(), 0).unwrap();
+            encoder.write_all(page).unwrap();
+            let compressed = encoder.finish().unwrap();
+            paged.extend_from_slice(&(compressed.len() as u32).to_le_bytes());
+            paged.extend_from_slice(&compressed);
+        }
+
+        let mut file = header();
+        let name = "renderdoc/internal/framecapture";
+        section(&mut file, 1, 0x4, name, &paged, contents.len());
+        section(&mut file, 4, 0, "renderdoc/ui/notes", b"Notes", 5);
+        let rdc = RdcFile::from_bytes(file).unwrap();
+        let frame = rdc.section(SectionType::FrameCapture).unwrap();
+
+        let mut streamed = Vec::new();
+        rdc.read_section(frame).read_to_end(&mut streamed).unwrap();
+        assert!(streamed == contents);
+
+        let mut decoder = SectionDecoder::new(3);
+        let mut out = Vec::new();
+        for _ in 0..2 {
+            let stats = decoder.decompress_into(&rdc, frame, &mut out).unwrap();
+            assert_eq!(stats.uncompressed_bytes, contents.len() as u64);
+            assert!(out == contents);
+        }
+
+        let notes = rdc.section(SectionType::Notes).unwrap();
+        assert_eq!(decoder.decompress(&rdc, notes).unwrap(), b"Notes");
+
+        let total = decoder.throughput(SectionType::FrameCapture).unwrap();
+        assert_eq!(total.compressed_bytes, 2 * paged.len() as u64);
+    }
+
+    /// Appends an LZ4 sequence of `literals` followed by an optional match of `(offset, len)`.
+    #[cfg(feature = "lz4")]
+    fn lz4_sequence(out: &mut Vec<u8>, literals: &[u8], matched: Option<(u16, usize)>) {
+        fn extra_len(out: &mut Vec<u8>, mut len: usize) {
+            while len >= 255 {
+                out.push(255);
+                len -= 255;
+            }
+            out.push(len as u8);
+        }
+
+        let match_len = matched.map_or(0, |(_, len)| len - 4);
+        out.push((literals.len().min(15) << 4 | match_len.min(15)) as u8);
+        if literals.len() >= 15 {
+            extra_len(out, literals.len() - 15);
+        }
+        out.extend_from_slice(literals);
+
+        if let Some((offset, _)) = matched {
+            out.extend_from_slice(&offset.to_le_bytes());
+            if match_len >= 15 {
+                extra_len(out, match_len - 15);
+            }
+        }
+    }
+
+    #[test]
+    #[cfg(feature = "lz4")]
+    fn lz4_pages_are_decoded_against_the_previous_page() {
+        let first = b"The quick brown fox jumps over the lazy dog. ";
+
+        // Each page starts with a match reaching back into the previous page.
+        let mut pages = vec![Vec::new(), Vec::new(), Vec::new()];
+        lz4_sequence(&mut pages[0], first, None);
+        lz4_sequence(&mut pages[1], b"", Some((first.len() as u16 - 4, 20)));
+        lz4_sequence(&mut pages[1], b"ed twice! 0123", None);
+        lz4_sequence(&mut pages[2], b"", Some((34, 10)));
+        lz4_sequence(&mut pages[2], b"ab", Some((2, 8)));
+        lz4_sequence(&mut pages[2], b"-end-!", None);
+
+        let mut contents = first.to_vec();
+        contents.extend_from_slice(b"quick brown fox jumped twice! 0123");
+        contents.extend_from_slice(b"quick brow");
+        contents.extend_from_slice(b"ababababab-end-!");
+
+        let mut paged = Vec::new();
+        for page in &pages {
+            paged.extend_from_slice(&(page.len() as u32).to_le_bytes());
+            paged.extend_from_slice(page);
+        }
+
+        let mut file = header();
+        let name = "renderdoc/internal/framecapture";
+        section(&mut file, 1, 0x2, name, &paged, contents.len());
+        section(&mut file, 4, 0, "renderdoc/ui/notes", b"Notes", 5);
+        let rdc = RdcFile::from_bytes(file).unwrap();
+        let frame = rdc.section(SectionType::FrameCapture).unwrap();
+
+        // Small reads make the reader cross page boundaries in the middle of a read.
+        let mut streamed = Vec::new();
+        let mut reader = rdc.read_section(frame);
+        let mut buf = [0u8; 7];
+        loop {
+            match reader.read(&mut buf).unwrap() {
+                0 => break,
+                n => streamed.extend_from_slice(&buf[..n]),
+            }
+        }
+        assert_eq!(streamed, contents);
+
+        let mut decoder = SectionDecoder::new(3);
+        assert_eq!(decoder.decompress(&rdc, frame).unwrap(), contents);
+    }
+}
@@ -1,30 +1,218 @@
 //! Type-safe wrapper around the RenderDoc API.
 
-use std::ffi::{CStr, CString};
+use std::ffi::CStr;
 use std::fmt::{Debug, Formatter, Result as FmtResult};
+use std::hash::{Hash, Hasher};
 use std::marker::PhantomData;
 use std::ops::{Deref, DerefMut};
+use std::os::raw::c_char;
 use std::path::{Path, PathBuf};
 use std::time::{Duration, SystemTime};
-use std::{ptr, time};
+use std::{mem, ptr, time};
 
 use float_cmp::approx_eq;
 
+use crate::backend::{Active, Backend};
+use crate::captures::Captures;
+use crate::dynamic::DynRenderDoc;
 use crate::error::Error;
+use crate::frame_capture::FrameCapture;
 use crate::handles::{DevicePointer, WindowHandle};
+use crate::marshal::{with_c_str, with_keys, with_opt_c_str, CStrArg, OptCStrArg};
 use crate::settings::{CaptureOption, InputButton, OverlayBits};
+use crate::shadow::Shadow;
 use crate::version::{Entry, HasPrevious, Version, V100, V110, V111, V112, V120, V130, V140, V141};
 
 /// An instance of the RenderDoc API with baseline version `V`.
+///
+/// All function pointers required by `V` are resolved and validated once on construction, so
+/// calling into the API afterwards never needs to re-check the entry point.
 #[repr(C)]
-#[derive(Eq, Hash, PartialEq)]
-pub struct RenderDoc<V>(*mut Entry, PhantomData<V>);
+pub struct RenderDoc<V>(Active, Shadow, PhantomData<V>);
 
 impl<V: Version> RenderDoc<V> {
     /// Initializes a new instance of the RenderDoc API.
+    ///
+    /// Returns an error if the library could not be loaded, or if it fails to provide any of the
+    /// functions required by API version `V`.
+    ///
+    /// With the `disabled` feature enabled, this always returns a disabled instance without
+    /// loading the library.
+    #[cfg(not(feature = "disabled"))]
     pub fn new() -> Result<Self, Error> {
         let api = V::load()?;
-        Ok(RenderDoc(api, PhantomData))
+        unsafe { Self::from_raw(api) }
+    }
+
+    /// Initializes a new instance of the RenderDoc API.
+    ///
+    /// Returns an error if the library could not be loaded, or if it fails to provide any of the
+    /// functions required by API version `V`.
+    ///
+    /// With the `disabled` feature enabled, this always returns a disabled instance without
+    /// loading the library.
+    #[cfg(feature = "disabled")]
+    pub fn new() -> Result<Self, Error> {
+        Ok(Self::disabled())
+    }
+
+    /// Initializes a new instance of the RenderDoc API, falling back to a disabled instance if the
+    /// library could not be loaded.
+    ///
+    /// This allows per-frame instrumentation to be called unconditionally, whether or not the
+    /// application is running under RenderDoc.
+    ///
+    /// # Examples
+    ///
+    /// ```rust
+    /// # use renderdoc::{RenderDoc, V141};
+    /// let mut renderdoc: RenderDoc<V141> = RenderDoc::new_or_disabled();
+    ///
+    /// renderdoc.start_frame_capture(std::ptr::null(), std::ptr::null());
+    /// // Do some rendering here...
+    /// renderdoc.end_frame_capture(std::ptr::null(), std::ptr::null());
+    /// ```
+    pub fn new_or_disabled() -> Self {
+        Self::new().unwrap_or_else(|_| Self::disabled())
+    }
+
+    /// Returns an instance on which every call does nothing, without loading the library.
+    ///
+    /// Setters have no effect, and getters return zero, `false` or `None`. Capture options and
+    /// overlay bits set through the instance are still cached, shared with every other disabled
+    /// instance, unless the `disabled` feature is enabled.
+    pub fn disabled() -> Self {
+        RenderDoc(Active::disabled(), Shadow::of(ptr::null_mut()), PhantomData)
+    }
+
+    /// Returns whether this instance is disabled, either with `disabled()`, by `new_or_disabled()`
+    /// failing to load the library, or at compile time by the `disabled` feature.
+    pub fn is_disabled(&self) -> bool {
+        self.0.entry().is_null()
+    }
+
+    /// Binds to an instance of the RenderDoc API which has already been injected into the process.
+    ///
+    /// Unlike `new()`, this never loads the RenderDoc library or searches the file system for it,
+    /// so it is cheap to call on hosts which are not being debugged. Returns `None` if RenderDoc
+    /// is not loaded, or if it fails to provide API version `V`.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{RenderDoc, V110};
+    /// let renderdoc: Option<RenderDoc<V110>> = RenderDoc::attach();
+    /// if renderdoc.is_none() {
+    ///     // Not running under RenderDoc, carry on without captures.
+    /// }
+    /// ```
+    ///
+    /// With the `disabled` feature enabled, this always returns `None`.
+    pub fn attach() -> Option<Self> {
+        if cfg!(feature = "disabled") {
+            return None;
+        }
+
+        let api = V::attach()?;
+        unsafe { Self::from_raw(api).ok() }
+    }
+
+    /// Wraps an existing entry point of the RenderDoc API.
+    ///
+    /// Returns an error if `api` is null or fails to provide any of the functions required by API
+    /// version `V`.
+    ///
+    /// # Safety
+    ///
+    /// `api` must point to a valid API structure of at least version `V`, and it must outlive the
+    /// returned instance.
+    ///
+    /// With the `disabled` feature enabled, `api` is ignored and a disabled instance is returned.
+    #[cfg(not(feature = "disabled"))]
+    pub unsafe fn from_raw(api: *mut Entry) -> Result<Self, Error> {
+        let table = crate::function_table::FunctionTable::resolve(api, V::VERSION)?;
+        Ok(RenderDoc(table, Shadow::of(api), PhantomData))
+    }
+
+    /// Wraps an existing entry point of the RenderDoc API.
+    ///
+    /// Returns an error if `api` is null or fails to provide any of the functions required by API
+    /// version `V`.
+    ///
+    /// # Safety
+    ///
+    /// `api` must point to a valid API structure of at least version `V`, and it must outlive the
+    /// returned instance.
+    ///
+    /// With the `disabled` feature enabled, `api` is ignored and a disabled instance is returned.
+    #[cfg(feature = "disabled")]
+    pub unsafe fn from_raw(_api: *mut Entry) -> Result<Self, Error> {
+        Ok(Self::disabled())
+    }
+
+    /// Begins a frame capture for the specified device/window combination, returning a guard
+    /// which ends the capture once it goes out of scope.
+    ///
+    /// Call [`FrameCapture::finish()`] to save the capture to disk. If the guard is dropped
+    /// instead, the capture is discarded where supported (API version 1.4.0 and newer), or ended
+    /// normally otherwise.
+    ///
+    /// If either or both `dev` and `win` are set to `std::ptr::null()`, then RenderDoc will
+    /// perform a wildcard match.
+    ///
+    /// [`FrameCapture::finish()`]: ./struct.FrameCapture.html#method.finish
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{Error, RenderDoc, V141};
+    /// # fn main() -> Result<(), Error> {
+    /// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+    ///
+    /// let capture = renderdoc.begin_capture(std::ptr::null(), std::ptr::null());
+    /// // Do some rendering here...
+    /// capture.finish();
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn begin_capture<D>(&mut self, dev: D, win: WindowHandle) -> FrameCapture<'_, V>
+    where
+        D: Into<DevicePointer>,
+    {
+        FrameCapture::new(self, dev, win)
+    }
+
+    pub(crate) fn table(&self) -> &Active {
+        &self.0
+    }
+
+    pub(crate) fn shadow(&self) -> &Shadow {
+        &self.1
+    }
+
+    /// Returns another handle to the same API instance.
+    pub(crate) fn duplicate(&self) -> Self {
+        RenderDoc(self.0, self.1, PhantomData)
+    }
+
+    /// Returns a handle calling inert stubs, whose cached state is not shared with any other
+    /// handle.
+    #[cfg(all(test, not(feature = "disabled")))]
+    pub(crate) fn isolated() -> Self {
+        // Leaked, so that every isolated handle has its own entry point to key its state by.
+        let entry = Box::into_raw(Box::new(0u64)) as *mut Entry;
+        let mut table = Active::disabled();
+        table.entry = entry;
+        RenderDoc(table, Shadow::of(entry), PhantomData)
+    }
+
+    /// Changes the API version marker without re-resolving any functions.
+    ///
+    /// # Safety
+    ///
+    /// The function table must provide every function required by `W`.
+    pub(crate) unsafe fn retag<W>(self) -> RenderDoc<W> {
+        RenderDoc(self.0, self.1, PhantomData)
     }
 
     /// Returns the raw entry point of the API.
@@ -34,7 +222,7 @@ impl<V: Version> RenderDoc<V> {
     /// Using the entry point structure directly will discard any thread safety provided by
     /// default with this library.
     pub unsafe fn raw_api(&self) -> *mut Entry {
-        self.0
+        self.0.entry()
     }
 
     /// Attempts to shut down RenderDoc.
@@ -54,7 +242,7 @@ impl<V: Version> RenderDoc<V> {
     // This is currently impossible to do until https://github.com/rust-lang/rfcs/issues/997 is
     // resolved, since `Deref` nor `DerefMut` is sufficient for the task.
     pub unsafe fn shutdown(self) {
-        ((*self.0).__bindgen_anon_1.Shutdown.unwrap())();
+        self.0.remove_hooks();
     }
 }
 
@@ -73,8 +261,8 @@ impl<V: HasPrevious> RenderDoc<V> {
     /// # }
     /// ```
     pub fn downgrade(self) -> RenderDoc<V::Previous> {
-        let RenderDoc(entry, _) = self;
-        RenderDoc(entry, PhantomData)
+        let RenderDoc(table, shadow, _) = self;
+        RenderDoc(table, shadow, PhantomData)
     }
 }
 
@@ -100,6 +288,28 @@ impl<V: HasPrevious> DerefMut for RenderDoc<V> {
 }
 
 impl RenderDoc<V100> {
+    /// Initializes the newest version of the RenderDoc API supported by the library.
+    ///
+    /// Unlike `new()`, the API version is negotiated at runtime rather than chosen at compile
+    /// time. The negotiated version is cached, so only the first call probes the library. Methods
+    /// of the returned handle report an error if the library is too old to provide them.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{Error, RenderDoc};
+    /// # fn main() -> Result<(), Error> {
+    /// let mut renderdoc = RenderDoc::new_best()?;
+    /// if let Err(e) = renderdoc.set_capture_file_comments(None, "Startup") {
+    ///     eprintln!("Cannot add comments: {}", e);
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn new_best() -> Result<DynRenderDoc, Error> {
+        DynRenderDoc::new()
+    }
+
     /// Returns the major, minor, and patch version numbers of the RenderDoc API currently in use.
     ///
     /// Note that RenderDoc will usually provide a higher API version than the one requested by
@@ -119,7 +329,7 @@ impl RenderDoc<V100> {
     pub fn get_api_version(&self) -> (u32, u32, u32) {
         unsafe {
             let (mut major, mut minor, mut patch) = (0, 0, 0);
-            ((*self.0).GetAPIVersion.unwrap())(&mut major, &mut minor, &mut patch);
+            self.0.get_api_version(&mut major, &mut minor, &mut patch);
             (major as u32, minor as u32, patch as u32)
         }
     }
@@ -130,8 +340,17 @@ impl RenderDoc<V100> {
     ///
     /// This method will panic if the option and/or the value are invalid.
     pub fn set_capture_option_f32(&mut self, opt: CaptureOption, val: f32) {
-        let err = unsafe { ((*self.0).SetCaptureOptionF32.unwrap())(opt as u32, val) };
-        assert_eq!(err, 1);
+        assert!(self.try_set_capture_option_f32(opt, val));
+    }
+
+    /// Sets `opt` to `val`, returning `false` instead of panicking if RenderDoc rejects it.
+    pub(crate) fn try_set_capture_option_f32(&mut self, opt: CaptureOption, val: f32) -> bool {
+        let ok = unsafe { self.0.set_capture_option_f32(opt as u32, val) == 1 };
+        if ok {
+            self.1.set_option(opt, opt.stored_f32(val));
+        }
+
+        ok
     }
 
     /// Sets the specified `CaptureOption` to the given `u32` value.
@@ -140,31 +359,56 @@ impl RenderDoc<V100> {
     ///
     /// This method will panic if the option and/or the value are invalid.
     pub fn set_capture_option_u32(&mut self, opt: CaptureOption, val: u32) {
-        let err = unsafe { ((*self.0).SetCaptureOptionU32.unwrap())(opt as u32, val) };
-        assert_eq!(err, 1);
+        assert!(self.try_set_capture_option_u32(opt, val));
+    }
+
+    /// Sets `opt` to `val`, returning `false` instead of panicking if RenderDoc rejects it.
+    pub(crate) fn try_set_capture_option_u32(&mut self, opt: CaptureOption, val: u32) -> bool {
+        let ok = unsafe { self.0.set_capture_option_u32(opt as u32, val) == 1 };
+        if ok {
+            self.1.set_option(opt, opt.stored_u32(val));
+        }
+
+        ok
     }
 
     /// Returns the value of the given `CaptureOption` as an `f32` value.
     ///
+    /// The value is only read from RenderDoc the first time, or after a call to `refresh()`, and
+    /// is cached for every handle in the process afterwards.
+    ///
     /// # Panics
     ///
     /// This method will panic if the option is invalid.
     pub fn get_capture_option_f32(&self, opt: CaptureOption) -> f32 {
         use std::f32::MAX;
-        let val = unsafe { ((*self.0).GetCaptureOptionF32.unwrap())(opt as u32) };
+        if let Some(val) = self.1.option(opt) {
+            return val as f32;
+        }
+
+        let val = unsafe { self.0.get_capture_option_f32(opt as u32) };
         assert!(!approx_eq!(f32, val, -MAX));
+        self.1.set_option(opt, opt.stored_f32(val));
         val
     }
 
     /// Returns the value of the given `CaptureOption` as a `u32` value.
     ///
+    /// The value is only read from RenderDoc the first time, or after a call to `refresh()`, and
+    /// is cached for every handle in the process afterwards.
+    ///
     /// # Panics
     ///
     /// This method will panic if the option is invalid.
     pub fn get_capture_option_u32(&self, opt: CaptureOption) -> u32 {
         use std::u32::MAX;
-        let val = unsafe { ((*self.0).GetCaptureOptionU32.unwrap())(opt as u32) };
+        if let Some(val) = self.1.option(opt) {
+            return val;
+        }
+
+        let val = unsafe { self.0.get_capture_option_u32(opt as u32) };
         assert_ne!(val, MAX);
+        self.1.set_option(opt, val);
         val
     }
 
@@ -172,20 +416,18 @@ impl RenderDoc<V100> {
     ///
     /// If the `keys` slice is empty, all existing capture key bindings are disabled.
     pub fn set_capture_keys<I: Into<InputButton> + Clone>(&mut self, keys: &[I]) {
-        unsafe {
-            let mut k: Vec<_> = keys.iter().cloned().map(|k| k.into() as u32).collect();
-            ((*self.0).SetCaptureKeys.unwrap())(k.as_mut_ptr(), k.len() as i32)
-        }
+        with_keys(keys, |k| unsafe {
+            self.0.set_capture_keys(k.as_mut_ptr(), k.len() as i32)
+        })
     }
 
     /// Sets the key bindings used in-application to switch focus between windows.
     ///
     /// If the `keys` slice is empty, all existing focus toggle key bindings are disabled.
     pub fn set_focus_toggle_keys<I: Into<InputButton> + Clone>(&mut self, keys: &[I]) {
-        unsafe {
-            let mut k: Vec<_> = keys.iter().cloned().map(|k| k.into() as u32).collect();
-            ((*self.0).SetFocusToggleKeys.unwrap())(k.as_mut_ptr(), k.len() as i32)
-        }
+        with_keys(keys, |k| unsafe {
+            self.0.set_focus_toggle_keys(k.as_mut_ptr(), k.len() as i32)
+        })
     }
 
     /// Removes RenderDoc's injected crash handler from the current process.
@@ -195,14 +437,25 @@ impl RenderDoc<V100> {
     /// will do nothing.
     pub fn unload_crash_handler(&mut self) {
         unsafe {
-            ((*self.0).UnloadCrashHandler.unwrap())();
+            self.0.unload_crash_handler();
         }
     }
 
     /// Returns a bitmask representing which elements of the RenderDoc overlay are being rendered
     /// on each window.
+    ///
+    /// The bitmask is only read from RenderDoc the first time, or after a call to `refresh()`, and
+    /// is cached for every handle in the process afterwards.
     pub fn get_overlay_bits(&self) -> OverlayBits {
-        let bits = unsafe { ((*self.0).GetOverlayBits.unwrap())() };
+        let bits = self.1.overlay().unwrap_or_else(|| {
+            // NOTE: Another handle may mask the bits while they are read, in which case the
+            // generation changes and the possibly stale value is not cached.
+            let generation = self.1.overlay_generation();
+            let bits = unsafe { self.0.get_overlay_bits() };
+            self.1.fill_overlay(generation, bits);
+            bits
+        });
+
         OverlayBits::from_bits_truncate(bits)
     }
 
@@ -213,8 +466,20 @@ impl RenderDoc<V100> {
     /// using a bitwise-or on top.
     pub fn mask_overlay_bits(&mut self, and: OverlayBits, or: OverlayBits) {
         unsafe {
-            ((*self.0).MaskOverlayBits.unwrap())(and.bits(), or.bits());
+            self.0.mask_overlay_bits(and.bits(), or.bits());
         }
+
+        self.1.mask_overlay(and.bits(), or.bits());
+    }
+
+    /// Discards the cached capture options and overlay bits, so that they are read from RenderDoc
+    /// again on next access through any handle.
+    ///
+    /// RenderDoc's settings are global to the process, so the cache is shared by every handle, and
+    /// values changed through any `RenderDoc` handle are always up to date. Call this if they may
+    /// have been changed outside of this library, such as by the replay UI over target control.
+    pub fn refresh(&mut self) {
+        self.1.clear();
     }
 
     /// Returns the path template where new captures will be stored.
@@ -238,7 +503,7 @@ impl RenderDoc<V100> {
     /// ```
     pub fn get_log_file_path_template(&self) -> &Path {
         unsafe {
-            let raw = ((*self.0).__bindgen_anon_3.GetLogFilePathTemplate.unwrap())();
+            let raw = self.0.get_capture_file_path_template();
             CStr::from_ptr(raw).to_str().map(Path::new).unwrap()
         }
     }
@@ -252,6 +517,8 @@ impl RenderDoc<V100> {
     /// The default template is in a folder controlled by the UI - initially the system temporary
     /// directory, and the filename is the executable's filename.
     ///
+    /// Templates which are not valid UTF-8 or contain a NUL byte are ignored.
+    ///
     /// # Examples
     ///
     /// ```rust,no_run
@@ -265,12 +532,12 @@ impl RenderDoc<V100> {
     /// # Ok(())
     /// # }
     /// ```
-    pub fn set_log_file_path_template<P: Into<PathBuf>>(&mut self, path_template: P) {
-        unsafe {
-            let utf8 = path_template.into().into_os_string().into_string().ok();
-            let path = utf8.and_then(|s| CString::new(s).ok()).unwrap();
-            ((*self.0).__bindgen_anon_2.SetLogFilePathTemplate.unwrap())(path.as_ptr());
-        }
+    pub fn set_log_file_path_template<P: CStrArg>(&mut self, path_template: P) {
+        with_c_str(&path_template, |path| {
+            if let Some(path) = path {
+                unsafe { self.0.set_capture_file_path_template(path.as_ptr()) };
+            }
+        })
     }
 
     /// Returns the number of frame captures that have been made.
@@ -286,7 +553,7 @@ impl RenderDoc<V100> {
     /// # }
     /// ```
     pub fn get_num_captures(&self) -> u32 {
-        unsafe { ((*self.0).GetNumCaptures.unwrap())() }
+        unsafe { self.0.get_num_captures() }
     }
 
     /// Retrieves the path and capture time of a capture file indexed by the number `index`.
@@ -309,25 +576,97 @@ impl RenderDoc<V100> {
     /// # }
     /// ```
     pub fn get_capture(&self, index: u32) -> Option<(PathBuf, SystemTime)> {
-        let mut len = self.get_log_file_path_template().as_os_str().len() as u32 + 128;
-        let mut path = Vec::with_capacity(len as usize);
+        let mut path = PathBuf::new();
+        self.get_capture_into(index, &mut path)
+            .map(|capture_time| (path, capture_time))
+    }
+
+    /// Retrieves the path and capture time of a capture file indexed by the number `index`,
+    /// writing the path into the existing `path` buffer.
+    ///
+    /// Returns `Some` with the capture time if the index was within `0..get_num_captures()`,
+    /// otherwise returns `None` and leaves `path` untouched.
+    ///
+    /// The allocation backing `path` is reused, so polling many captures with the same buffer
+    /// does not allocate once it has grown large enough to hold the longest path.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{Error, RenderDoc, V100};
+    /// # use std::path::PathBuf;
+    /// # fn main() -> Result<(), Error> {
+    /// let renderdoc: RenderDoc<V100> = RenderDoc::new()?;
+    ///
+    /// let mut path = PathBuf::new();
+    /// for index in 0..renderdoc.get_num_captures() {
+    ///     if let Some(capture_time) = renderdoc.get_capture_into(index, &mut path) {
+    ///         println!("{}: {:?}", path.display(), capture_time);
+    ///     }
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn get_capture_into(&self, index: u32, path: &mut PathBuf) -> Option<SystemTime> {
+        let mut len = 0u32;
         let mut time = 0u64;
 
         unsafe {
-            if ((*self.0).GetCapture.unwrap())(index, path.as_mut_ptr(), &mut len, &mut time) == 1 {
-                let capture_time = time::UNIX_EPOCH + Duration::from_secs(time);
-                let path = {
-                    let raw_path = CString::from_raw(path.as_mut_ptr());
-                    let mut path = raw_path.into_string().unwrap();
-                    path.shrink_to_fit();
-                    path
-                };
-
-                Some((path.into(), capture_time))
-            } else {
-                None
+            // Query the length of the path, including the NUL terminator, before fetching it.
+            if self
+                .0
+                .get_capture(index, ptr::null_mut(), &mut len, ptr::null_mut())
+                != 1
+            {
+                return None;
+            }
+
+            // The new path is written after the current one, so that the current one can be put
+            // back untouched if the capture disappeared in between the two calls.
+            let (mut buf, unusable) = match path_into_bytes(mem::replace(path, PathBuf::new())) {
+                Ok(buf) => (buf, None),
+                Err(original) => (Vec::new(), Some(original)),
+            };
+            let start = buf.len();
+            let reserved = len as usize;
+            buf.reserve(reserved);
+
+            // NOTE: The capture list may have changed between the two calls, and only `reserved`
+            // bytes are known to be initialized by RenderDoc if the path became longer.
+            let raw = buf.as_mut_ptr().add(start) as *mut c_char;
+            if self.0.get_capture(index, raw, &mut len, &mut time) != 1 || len as usize > reserved {
+                *path = unusable.unwrap_or_else(|| path_from_bytes(buf));
+                return None;
+            }
+
+            buf.set_len(start + len as usize);
+            if let Some(nul) = buf[start..].iter().position(|&b| b == 0) {
+                buf.truncate(start + nul);
             }
+
+            buf.drain(..start);
+            *path = path_from_bytes(buf);
         }
+
+        Some(time::UNIX_EPOCH + Duration::from_secs(time))
+    }
+
+    /// Returns an iterator over the paths and capture times of all captures made so far.
+    ///
+    /// # Examples
+    ///
+    /// ```rust,no_run
+    /// # use renderdoc::{Error, RenderDoc, V100};
+    /// # fn main() -> Result<(), Error> {
+    /// let renderdoc: RenderDoc<V100> = RenderDoc::new()?;
+    /// for (path, capture_time) in renderdoc.captures() {
+    ///     println!("{}: {:?}", path.display(), capture_time);
+    /// }
+    /// # Ok(())
+    /// # }
+    /// ```
+    pub fn captures(&self) -> Captures<'_> {
+        Captures::new(self)
     }
 
     /// Captures the next frame from the currently active window and API device.
@@ -347,7 +686,7 @@ impl RenderDoc<V100> {
     /// ```
     pub fn trigger_capture(&mut self) {
         unsafe {
-            ((*self.0).TriggerCapture.unwrap())();
+            self.0.trigger_capture();
         }
     }
 
@@ -364,7 +703,7 @@ impl RenderDoc<V100> {
     /// # }
     /// ```
     pub fn is_remote_access_connected(&self) -> bool {
-        unsafe { ((*self.0).__bindgen_anon_4.IsRemoteAccessConnected.unwrap())() == 1 }
+        unsafe { self.0.is_target_control_connected() == 1 }
     }
 
     /// Launches the replay UI associated with the RenderDoc library injected into the running
@@ -395,15 +734,12 @@ impl RenderDoc<V100> {
         O: Into<Option<&'a str>>,
     {
         let should_connect = connect_immediately as u32;
-        let utf8 = extra_opts.into().and_then(|s| CString::new(s).ok());
-        let extra_opts = utf8.as_ref().map(|s| s.as_ptr()).unwrap_or_else(ptr::null);
-
-        unsafe {
-            match ((*self.0).LaunchReplayUI.unwrap())(should_connect, extra_opts) {
+        with_opt_c_str(&extra_opts.into(), |extra_opts| unsafe {
+            match self.0.launch_replay_ui(should_connect, extra_opts) {
                 0 => Err(Error::launch_replay_ui()),
                 pid => Ok(pid),
             }
-        }
+        })
     }
 
     /// Explicitly set which window is considered "active" by RenderDoc.
@@ -418,7 +754,7 @@ impl RenderDoc<V100> {
     {
         unsafe {
             let DevicePointer(dev) = dev.into();
-            ((*self.0).SetActiveWindow.unwrap())(dev as *mut _, win as *mut _);
+            self.0.set_active_window(dev as *mut _, win as *mut _);
         }
     }
 
@@ -448,7 +784,7 @@ impl RenderDoc<V100> {
     {
         unsafe {
             let DevicePointer(dev) = dev.into();
-            ((*self.0).StartFrameCapture.unwrap())(dev as *mut _, win as *mut _);
+            self.0.start_frame_capture(dev as *mut _, win as *mut _);
         }
     }
 
@@ -469,7 +805,7 @@ impl RenderDoc<V100> {
     /// # }
     /// ```
     pub fn is_frame_capturing(&self) -> bool {
-        unsafe { ((*self.0).IsFrameCapturing.unwrap())() == 1 }
+        unsafe { self.0.is_frame_capturing() == 1 }
     }
 
     /// Ends a frame capture for the specified device/window combination, saving results to disk.
@@ -499,11 +835,45 @@ impl RenderDoc<V100> {
     {
         unsafe {
             let DevicePointer(dev) = dev.into();
-            ((*self.0).EndFrameCapture.unwrap())(dev as *mut _, win as *mut _);
+            self.0.end_frame_capture(dev as *mut _, win as *mut _);
         }
     }
 }
 
+/// Takes the bytes of `path` for reuse as a buffer, or returns `path` if they cannot be reused.
+#[cfg(unix)]
+fn path_into_bytes(path: PathBuf) -> Result<Vec<u8>, PathBuf> {
+    use std::os::unix::ffi::OsStringExt;
+    Ok(path.into_os_string().into_vec())
+}
+
+/// Takes the bytes of `path` for reuse as a buffer, or returns `path` if they cannot be reused.
+#[cfg(not(unix))]
+fn path_into_bytes(path: PathBuf) -> Result<Vec<u8>, PathBuf> {
+    let os = path.into_os_string();
+    os.into_string()
+        .map(String::into_bytes)
+        .map_err(PathBuf::from)
+}
+
+/// Converts a path returned by RenderDoc back into a `PathBuf`, without copying it.
+#[cfg(unix)]
+fn path_from_bytes(buf: Vec<u8>) -> PathBuf {
+    use std::ffi::OsString;
+    use std::os::unix::ffi::OsStringExt;
+    PathBuf::from(OsString::from_vec(buf))
+}
+
+/// Converts a path returned by RenderDoc back into a `PathBuf`, without copying it unless it is
+/// not valid UTF-8.
+#[cfg(not(unix))]
+fn path_from_bytes(buf: Vec<u8>) -> PathBuf {
+    match String::from_utf8(buf) {
+        Ok(utf8) => PathBuf::from(utf8),
+        Err(e) => PathBuf::from(String::from_utf8_lossy(e.as_bytes()).into_owned()),
+    }
+}
+
 impl RenderDoc<V110> {
     /// Captures the next _n_ frames from the currently active window and API device.
     ///
@@ -511,7 +881,7 @@ impl RenderDoc<V110> {
     /// `set_log_file_path_template()`.
     pub fn trigger_multi_frame_capture(&mut self, num_frames: u32) {
         unsafe {
-            ((*self.0).TriggerMultiFrameCapture.unwrap())(num_frames);
+            self.0.trigger_multi_frame_capture(num_frames);
         }
     }
 }
@@ -530,7 +900,7 @@ impl RenderDoc<V111> {
     /// # }
     /// ```
     pub fn is_target_control_connected(&self) -> bool {
-        unsafe { ((*self.0).__bindgen_anon_4.IsTargetControlConnected.unwrap())() == 1 }
+        unsafe { self.0.is_target_control_connected() == 1 }
     }
 
     /// Returns whether the RenderDoc UI is connected to this application.
@@ -563,10 +933,7 @@ impl RenderDoc<V112> {
     /// ```
     pub fn get_capture_file_path_template(&self) -> &Path {
         unsafe {
-            let raw = ((*self.0)
-                .__bindgen_anon_3
-                .GetCaptureFilePathTemplate
-                .unwrap())();
+            let raw = self.0.get_capture_file_path_template();
             CStr::from_ptr(raw).to_str().map(Path::new).unwrap()
         }
     }
@@ -580,6 +947,8 @@ impl RenderDoc<V112> {
     /// The default template is in a folder controlled by the UI - initially the system temporary
     /// directory, and the filename is the executable's filename.
     ///
+    /// Templates which are not valid UTF-8 or contain a NUL byte are ignored.
+    ///
     /// # Examples
     ///
     /// ```rust,no_run
@@ -593,15 +962,12 @@ impl RenderDoc<V112> {
     /// # Ok(())
     /// # }
     /// ```
-    pub fn set_capture_file_path_template<P: Into<PathBuf>>(&mut self, path_template: P) {
-        let utf8 = path_template.into().into_os_string().into_string().ok();
-        let cstr = utf8.and_then(|s| CString::new(s).ok()).unwrap();
-        unsafe {
-            ((*self.0)
-                .__bindgen_anon_2
-                .SetCaptureFilePathTemplate
-                .unwrap())(cstr.as_ptr());
-        }
+    pub fn set_capture_file_path_template<P: CStrArg>(&mut self, path_template: P) {
+        with_c_str(&path_template, |path| {
+            if let Some(path) = path {
+                unsafe { self.0.set_capture_file_path_template(path.as_ptr()) };
+            }
+        })
     }
 
     /// Returns the path template where new captures will be stored.
@@ -613,7 +979,7 @@ impl RenderDoc<V112> {
 
     /// Sets the path template where new capture files should be stored.
     #[deprecated(since = "1.1.2", note = "renamed to `set_capture_file_path_template`")]
-    pub fn set_log_file_path_template<P: Into<PathBuf>>(&mut self, path_template: P) {
+    pub fn set_log_file_path_template<P: CStrArg>(&mut self, path_template: P) {
         let v1: &mut RenderDoc<V100> = self.deref_mut();
         v1.set_log_file_path_template(path_template)
     }
@@ -623,19 +989,21 @@ impl RenderDoc<V120> {
     /// Adds or sets an arbitrary comments field to an existing capture on disk, which will then be
     /// displayed in the UI to anyone opening the capture file.
     ///
-    /// If the `path` argument is `None`, the most recent previous capture file is used.
-    pub fn set_capture_file_comments<'a, P, C>(&mut self, path: P, comments: C)
+    /// The `path` argument accepts any `CStrArg`, such as a `&Path` or `&CStr`. If it is `None`,
+    /// the most recent previous capture file is used. Comments which contain a NUL byte are
+    /// ignored.
+    pub fn set_capture_file_comments<P, C>(&mut self, path: P, comments: C)
     where
-        P: Into<Option<&'a str>>,
-        C: Into<String>,
+        P: OptCStrArg,
+        C: CStrArg,
     {
-        let utf8 = path.into().and_then(|s| CString::new(s).ok());
-        let path = utf8.as_ref().map(|s| s.as_ptr()).unwrap_or_else(ptr::null);
-        let comments = CString::new(comments.into()).unwrap();
-
-        unsafe {
-            ((*self.0).SetCaptureFileComments.unwrap())(path, comments.as_ptr());
-        }
+        with_opt_c_str(&path, |path| {
+            with_c_str(&comments, |comments| {
+                if let Some(comments) = comments {
+                    unsafe { self.0.set_capture_file_comments(path, comments.as_ptr()) };
+                }
+            })
+        })
     }
 }
 
@@ -648,19 +1016,33 @@ impl RenderDoc<V140> {
         D: Into<DevicePointer>,
     {
         let DevicePointer(dev) = dev.into();
-        unsafe { ((*self.0).DiscardFrameCapture.unwrap())(dev as *mut _, win as *mut _) == 1 }
+        unsafe { self.0.discard_frame_capture(dev as *mut _, win as *mut _) == 1 }
     }
 }
 
 impl<V: Version> Debug for RenderDoc<V> {
     fn fmt(&self, fmt: &mut Formatter) -> FmtResult {
         fmt.debug_tuple(stringify!(RenderDoc))
-            .field(&self.0)
+            .field(&self.0.entry())
             .field(&V::VERSION)
             .finish()
     }
 }
 
+impl<V> Eq for RenderDoc<V> {}
+
+impl<V> PartialEq for RenderDoc<V> {
+    fn eq(&self, other: &Self) -> bool {
+        self.0 == other.0
+    }
+}
+
+impl<V> Hash for RenderDoc<V> {
+    fn hash<H: Hasher>(&self, state: &mut H) {
+        self.0.hash(state);
+    }
+}
+
 unsafe impl<V> Send for RenderDoc<V> {}
 
 /// Generates `From` implementations that permit downgrading of API versions.
@@ -716,8 +1098,8 @@ macro_rules! impl_from_versions {
                 Self: Sized,
             {
                 fn from(newer: RenderDoc<$newer>) -> Self {
-                    let RenderDoc(entry, _) = newer;
-                    RenderDoc(entry, PhantomData)
+                    let RenderDoc(table, shadow, _) = newer;
+                    RenderDoc(table, shadow, PhantomData)
                 }
             }
         )+
@@ -727,3 +1109,42 @@ macro_rules! impl_from_versions {
 }
 
 impl_from_versions!(V141, V140, V130, V120, V112, V111, V110, V100);
+
+#[cfg(test)]
+#[cfg(all(feature = "mock", not(feature = "disabled")))]
+mod tests {
+    use super::*;
+    use crate::mock;
+
+    #[test]
+    fn get_capture_into_reuses_and_restores_path() {
+        let _lock = mock::lock_for_test();
+        let mut rd = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+        let dir = std::env::temp_dir().join("renderdoc-rs-get-capture");
+        rd.set_capture_file_path_template(dir.join("game"));
+        let first = rd.get_num_captures();
+        rd.trigger_capture();
+        rd.trigger_capture();
+
+        let (expected, expected_time) = rd.get_capture(first).unwrap();
+        let mut path = PathBuf::new();
+        assert_eq!(rd.get_capture_into(first, &mut path), Some(expected_time));
+        assert_eq!(path, expected);
+
+        let (expected, _) = rd.get_capture(first + 1).unwrap();
+        assert!(rd.get_capture_into(first + 1, &mut path).is_some());
+        assert_eq!(path, expected);
+
+        #[cfg(unix)]
+        {
+            use std::os::unix::ffi::OsStringExt;
+            path = PathBuf::from(std::ffi::OsString::from_vec(vec![0xff, 0xfe]));
+            assert!(rd.get_capture_into(first, &mut path).is_some());
+            assert_eq!(path, rd.get_capture(first).unwrap().0);
+        }
+
+        let previous = path.clone();
+        assert_eq!(rd.get_capture_into(u32::max_value(), &mut path), None);
+        assert_eq!(path, previous);
+    }
+}
@@ -0,0 +1,457 @@
+//! Disk budget enforcement for capture files.
+
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::mpsc::{self, Sender};
+use std::sync::Arc;
+use std::thread::{self, JoinHandle};
+use std::time::SystemTime;
+
+use crate::captures::CaptureWatcher;
+use crate::renderdoc::RenderDoc;
+use crate::version::V100;
+
+/// Strategy for choosing which capture to delete when a budget is exceeded.
+#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+pub enum Eviction {
+    /// Delete the oldest capture first.
+    Oldest,
+    /// Delete the capture which was least recently marked as used with `touch()`.
+    LeastRecentlyUsed,
+    /// Delete the capture with the lowest priority first, least recently used among equals.
+    LowestPriority,
+}
+
+impl Default for Eviction {
+    fn default() -> Self {
+        Eviction::LeastRecentlyUsed
+    }
+}
+
+/// A capture file tracked by a `CaptureRetention`.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct RetainedCapture {
+    path: PathBuf,
+    size: u64,
+    capture_time: SystemTime,
+    last_used: u64,
+    priority: i32,
+    settled: bool,
+}
+
+impl RetainedCapture {
+    fn new(path: PathBuf, capture_time: SystemTime, last_used: u64) -> Self {
+        RetainedCapture {
+            path,
+            size: 0,
+            capture_time,
+            last_used,
+            priority: 0,
+            settled: false,
+        }
+    }
+
+    /// Reads the size of the file again, until it is seen with the same non-zero size twice.
+    ///
+    /// Returns the previous size.
+    fn refresh_size(&mut self) -> u64 {
+        let previous = self.size;
+        if !self.settled {
+            self.size = fs::metadata(&self.path).map(|m| m.len()).unwrap_or(0);
+            self.settled = self.size != 0 && self.size == previous;
+        }
+
+        previous
+    }
+
+    /// Returns the path of the capture file.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// Returns the size of the capture file in bytes.
+    ///
+    /// Captures are listed by RenderDoc before their file has been written, so the size is read
+    /// again on every `update()` until it stops changing.
+    pub fn size(&self) -> u64 {
+        self.size
+    }
+
+    /// Returns the time at which the capture was made.
+    pub fn capture_time(&self) -> SystemTime {
+        self.capture_time
+    }
+
+    /// Returns the eviction priority of the capture.
+    pub fn priority(&self) -> i32 {
+        self.priority
+    }
+}
+
+/// Current disk usage of the captures managed by a `CaptureRetention`.
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct RetentionUsage {
+    /// Number of captures currently retained.
+    pub captures: usize,
+    /// Total size in bytes of the captures currently retained.
+    pub bytes: u64,
+    /// Number of evicted captures still waiting to be deleted.
+    pub pending_deletions: u64,
+    /// Number of capture files deleted so far.
+    pub deleted: u64,
+    /// Number of capture files which could not be deleted.
+    pub failed_deletions: u64,
+}
+
+/// Keeps the capture files written by RenderDoc within a byte and count budget.
+///
+/// Every call to [`update()`] picks up the captures reported by `get_capture()` since the previous
+/// call, records their size on disk and then evicts captures until both budgets are met. The size
+/// of captures which are still being written is read again on later calls, until it stops
+/// changing. Files are deleted on a background thread, so the calling thread never blocks on the
+/// file system beyond reading the size of recent captures.
+///
+/// Only captures made through the given `RenderDoc` instance are considered. Other files in the
+/// capture directory are left untouched.
+///
+/// [`update()`]: #method.update
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureRetention, Error, Eviction, RenderDoc, V112};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V112> = RenderDoc::new()?;
+/// renderdoc.set_capture_file_path_template("/tmp/soak/capture");
+///
+/// let mut retention = CaptureRetention::new()
+///     .max_bytes(10 * 1024 * 1024 * 1024)
+///     .max_captures(200)
+///     .eviction(Eviction::Oldest);
+///
+/// loop {
+///     // Render a frame here...
+///     retention.update(&renderdoc);
+///
+///     if retention.usage().bytes > 8 * 1024 * 1024 * 1024 {
+///         eprintln!("Capture directory is nearly full");
+///     }
+/// #   break;
+/// }
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct CaptureRetention {
+    max_bytes: Option<u64>,
+    max_captures: Option<usize>,
+    eviction: Eviction,
+    watcher: CaptureWatcher,
+    captures: Vec<RetainedCapture>,
+    bytes: u64,
+    clock: u64,
+    deleter: Option<Deleter>,
+    stats: Arc<DeleterStats>,
+}
+
+impl CaptureRetention {
+    /// Creates a new `CaptureRetention` without any budget.
+    pub fn new() -> Self {
+        CaptureRetention {
+            max_bytes: None,
+            max_captures: None,
+            eviction: Eviction::default(),
+            watcher: CaptureWatcher::new(),
+            captures: Vec::new(),
+            bytes: 0,
+            clock: 0,
+            deleter: None,
+            stats: Arc::new(DeleterStats::default()),
+        }
+    }
+
+    /// Limits the total size of the retained captures to `bytes`.
+    pub fn max_bytes(mut self, bytes: u64) -> Self {
+        self.max_bytes = Some(bytes);
+        self
+    }
+
+    /// Limits the number of retained captures to `count`.
+    pub fn max_captures(mut self, count: usize) -> Self {
+        self.max_captures = Some(count);
+        self
+    }
+
+    /// Sets the strategy used to choose which captures to delete.
+    pub fn eviction(mut self, eviction: Eviction) -> Self {
+        self.eviction = eviction;
+        self
+    }
+
+    /// Ignores all captures made before this point, leaving them on disk.
+    pub fn skip_existing(mut self, renderdoc: &RenderDoc<V100>) -> Self {
+        self.watcher = CaptureWatcher::skip_existing(renderdoc);
+        self
+    }
+
+    /// Returns the captures currently retained, oldest first.
+    pub fn captures(&self) -> &[RetainedCapture] {
+        &self.captures
+    }
+
+    /// Returns the current disk usage.
+    pub fn usage(&self) -> RetentionUsage {
+        let deleted = self.stats.deleted.load(Ordering::Relaxed);
+        let failed = self.stats.failed.load(Ordering::Relaxed);
+        let submitted = self.stats.submitted.load(Ordering::Relaxed);
+
+        RetentionUsage {
+            captures: self.captures.len(),
+            bytes: self.bytes,
+            pending_deletions: submitted.saturating_sub(deleted + failed),
+            deleted,
+            failed_deletions: failed,
+        }
+    }
+
+    /// Tracks any new captures and evicts captures until the budgets are met.
+    ///
+    /// Returns the number of captures evicted by this call.
+    pub fn update(&mut self, renderdoc: &RenderDoc<V100>) -> usize {
+        if self.watcher.has_new(renderdoc) {
+            for (path, capture_time) in self.watcher.poll(renderdoc) {
+                self.clock += 1;
+                let capture = RetainedCapture::new(path, capture_time, self.clock);
+                self.captures.push(capture);
+            }
+        }
+
+        for capture in self.captures.iter_mut().filter(|c| !c.settled) {
+            let previous = capture.refresh_size();
+            self.bytes = self.bytes - previous + capture.size;
+        }
+
+        let mut evicted = 0;
+        while self.over_budget() {
+            let index = match self.victim() {
+                Some(index) => index,
+                None => break,
+            };
+
+            let capture = self.captures.remove(index);
+            self.bytes -= capture.size;
+            self.delete(capture.path);
+            evicted += 1;
+        }
+
+        evicted
+    }
+
+    /// Marks the capture at `path` as used, protecting it from `LeastRecentlyUsed` eviction.
+    ///
+    /// Returns `false` if no such capture is retained.
+    pub fn touch<P: AsRef<Path>>(&mut self, path: P) -> bool {
+        let clock = self.clock + 1;
+        match self.find_mut(path.as_ref()) {
+            Some(capture) => capture.last_used = clock,
+            None => return false,
+        }
+
+        self.clock = clock;
+        true
+    }
+
+    /// Sets the priority of the capture at `path` for `LowestPriority` eviction.
+    ///
+    /// Returns `false` if no such capture is retained.
+    pub fn set_priority<P: AsRef<Path>>(&mut self, path: P, priority: i32) -> bool {
+        match self.find_mut(path.as_ref()) {
+            Some(capture) => {
+                capture.priority = priority;
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Stops tracking the capture at `path` without deleting it.
+    ///
+    /// Returns `false` if no such capture is retained.
+    pub fn forget<P: AsRef<Path>>(&mut self, path: P) -> bool {
+        let path = path.as_ref();
+        match self.captures.iter().position(|c| c.path == path) {
+            Some(index) => {
+                self.bytes -= self.captures.remove(index).size;
+                true
+            }
+            None => false,
+        }
+    }
+
+    fn find_mut(&mut self, path: &Path) -> Option<&mut RetainedCapture> {
+        self.captures.iter_mut().find(|c| c.path == path)
+    }
+
+    fn over_budget(&self) -> bool {
+        let over_bytes = self.max_bytes.map_or(false, |max| self.bytes > max);
+        let over_count = self
+            .max_captures
+            .map_or(false, |max| self.captures.len() > max);
+        over_bytes || over_count
+    }
+
+    fn victim(&self) -> Option<usize> {
+        let captures = self.captures.iter().enumerate();
+        match self.eviction {
+            Eviction::Oldest => captures.min_by_key(|&(index, _)| index),
+            Eviction::LeastRecentlyUsed => captures.min_by_key(|&(_, c)| c.last_used),
+            Eviction::LowestPriority => captures.min_by_key(|&(_, c)| (c.priority, c.last_used)),
+        }
+        .map(|(index, _)| index)
+    }
+
+    fn delete(&mut self, path: PathBuf) {
+        let stats = &self.stats;
+        let deleter = self
+            .deleter
+            .get_or_insert_with(|| Deleter::spawn(stats.clone()));
+
+        stats.submitted.fetch_add(1, Ordering::Relaxed);
+        deleter.sender.send(path).expect("Deletion thread exited");
+    }
+}
+
+impl Default for CaptureRetention {
+    fn default() -> Self {
+        CaptureRetention::new()
+    }
+}
+
+#[derive(Debug, Default)]
+struct DeleterStats {
+    submitted: AtomicU64,
+    deleted: AtomicU64,
+    failed: AtomicU64,
+}
+
+/// Background thread which removes evicted capture files.
+#[derive(Debug)]
+struct Deleter {
+    sender: Sender<PathBuf>,
+    thread: Option<JoinHandle<()>>,
+}
+
+impl Deleter {
+    fn spawn(stats: Arc<DeleterStats>) -> Self {
+        let (sender, receiver) = mpsc::channel::<PathBuf>();
+        let thread = thread::Builder::new()
+            .name("renderdoc-retention".into())
+            .spawn(move || {
+                for path in receiver {
+                    match fs::remove_file(&path) {
+                        Ok(()) => stats.deleted.fetch_add(1, Ordering::Relaxed),
+                        Err(_) => stats.failed.fetch_add(1, Ordering::Relaxed),
+                    };
+                }
+            })
+            .expect("Failed to spawn deletion thread");
+
+        Deleter {
+            sender,
+            thread: Some(thread),
+        }
+    }
+}
+
+impl Drop for Deleter {
+    fn drop(&mut self) {
+        // Closing the channel lets the thread finish the remaining deletions and exit.
+        let (sender, _) = mpsc::channel();
+        drop(std::mem::replace(&mut self.sender, sender));
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn retention(eviction: Eviction) -> CaptureRetention {
+        let mut retention = CaptureRetention::new().max_captures(2).eviction(eviction);
+        for (i, name) in ["a.rdc", "b.rdc", "c.rdc"].iter().enumerate() {
+            let path = PathBuf::from(name);
+            let capture = RetainedCapture::new(path, SystemTime::UNIX_EPOCH, i as u64);
+            retention.captures.push(capture);
+        }
+        retention.clock = 3;
+        retention
+    }
+
+    #[test]
+    fn eviction_order() {
+        let mut lru = retention(Eviction::LeastRecentlyUsed);
+        assert!(lru.touch("a.rdc"));
+        assert_eq!(
+            lru.captures[lru.victim().unwrap()].path(),
+            Path::new("b.rdc")
+        );
+
+        let mut oldest = retention(Eviction::Oldest);
+        oldest.touch("a.rdc");
+        assert_eq!(oldest.victim(), Some(0));
+
+        let mut priority = retention(Eviction::LowestPriority);
+        priority.set_priority("a.rdc", 1);
+        priority.set_priority("b.rdc", 1);
+        assert_eq!(priority.victim(), Some(2));
+    }
+
+    #[test]
+    #[cfg(all(feature = "mock", not(feature = "disabled")))]
+    fn update_enforces_budgets_on_files_being_written() {
+        use crate::version::V112;
+
+        let _lock = crate::mock::lock_for_test();
+        let dir =
+            std::env::temp_dir().join(format!("renderdoc-rs-retention-{}", std::process::id()));
+        fs::create_dir_all(&dir).unwrap();
+
+        let mut rd = unsafe { RenderDoc::<V112>::from_raw(crate::mock::entry()).unwrap() };
+        rd.set_capture_file_path_template(dir.join("capture"));
+        let latest = |rd: &RenderDoc<V112>| rd.get_capture(rd.get_num_captures() - 1).unwrap().0;
+        let mut retention = CaptureRetention::new()
+            .max_bytes(150)
+            .max_captures(3)
+            .eviction(Eviction::Oldest)
+            .skip_existing(&rd);
+
+        // The first capture is listed before RenderDoc has written its file.
+        rd.trigger_capture();
+        assert_eq!(retention.update(&rd), 0);
+        let first = latest(&rd);
+        assert_eq!(retention.usage().bytes, 0);
+
+        fs::write(&first, [0u8; 100]).unwrap();
+        rd.trigger_capture();
+        fs::write(latest(&rd), [0u8; 100]).unwrap();
+        assert_eq!(retention.update(&rd), 1);
+        assert_eq!(retention.usage().bytes, 100);
+
+        for _ in 0..3 {
+            rd.trigger_capture();
+            fs::write(latest(&rd), [0u8; 1]).unwrap();
+        }
+        assert_eq!(retention.update(&rd), 1);
+        assert_eq!(retention.usage().captures, 3);
+        assert_eq!(retention.usage().bytes, 3);
+
+        drop(retention);
+        let remaining = fs::read_dir(&dir).unwrap().count();
+        fs::remove_dir_all(&dir).unwrap();
+        assert!(!first.exists());
+        assert_eq!(remaining, 3);
+    }
+}
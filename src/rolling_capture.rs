@@ -0,0 +1,265 @@
+//! Continuous capturing which keeps only the frames that turn out to be interesting.
+
+use std::time::{Duration, Instant};
+
+use crate::handles::{DevicePointer, WindowHandle};
+use crate::renderdoc::RenderDoc;
+use crate::version::V140;
+
+/// Captures every frame and decides at the end of each one whether to keep or discard it.
+///
+/// This makes it possible to catch rare events such as frame time spikes after they have already
+/// happened, without a human having to trigger the capture. Each frame is wrapped in a
+/// `start_frame_capture()` call, and at the end of the frame the capture is either saved to disk
+/// with `end_frame_capture()` or thrown away with `discard_frame_capture()`. Frames can be kept
+/// based on a frame time threshold, with [`end_frame()`], or by an arbitrary predicate, with
+/// [`end_frame_with()`].
+///
+/// Capturing every frame is not free, so the controller also keeps track of the time spent
+/// starting and discarding captures which were not kept. See [`RollingCaptureStats`].
+///
+/// [`end_frame()`]: #method.end_frame
+/// [`end_frame_with()`]: #method.end_frame_with
+/// [`RollingCaptureStats`]: ./struct.RollingCaptureStats.html
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{Error, RenderDoc, RollingCapture, V140};
+/// # use std::time::Duration;
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V140> = RenderDoc::new()?;
+/// let mut rolling = RollingCapture::with_threshold(Duration::from_millis(33));
+///
+/// loop {
+///     rolling.begin_frame(&mut renderdoc, std::ptr::null(), std::ptr::null());
+///     // Render a frame here...
+///     if rolling.end_frame(&mut renderdoc) {
+///         println!("Captured a slow frame!");
+///     }
+/// #   break;
+/// }
+///
+/// println!("{:?}", rolling.stats());
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct RollingCapture {
+    threshold: Option<Duration>,
+    frame: Option<Frame>,
+    stats: RollingCaptureStats,
+}
+
+#[derive(Debug)]
+struct Frame {
+    device: DevicePointer,
+    window: WindowHandle,
+    started: Instant,
+    start_overhead: Duration,
+}
+
+impl RollingCapture {
+    /// Creates a new `RollingCapture` which keeps frames selected by `end_frame_with()`.
+    ///
+    /// Without a threshold, `end_frame()` discards every frame.
+    pub fn new() -> Self {
+        RollingCapture {
+            threshold: None,
+            frame: None,
+            stats: RollingCaptureStats::default(),
+        }
+    }
+
+    /// Creates a new `RollingCapture` which keeps every frame that takes longer than `threshold`.
+    pub fn with_threshold(threshold: Duration) -> Self {
+        RollingCapture {
+            threshold: Some(threshold),
+            ..RollingCapture::new()
+        }
+    }
+
+    /// Returns the frame time above which `end_frame()` keeps a capture, if any.
+    pub fn threshold(&self) -> Option<Duration> {
+        self.threshold
+    }
+
+    /// Sets the frame time above which `end_frame()` keeps a capture.
+    pub fn set_threshold<T: Into<Option<Duration>>>(&mut self, threshold: T) {
+        self.threshold = threshold.into();
+    }
+
+    /// Returns statistics about the frames processed so far.
+    pub fn stats(&self) -> &RollingCaptureStats {
+        &self.stats
+    }
+
+    /// Returns whether a frame is currently being captured.
+    pub fn is_capturing(&self) -> bool {
+        self.frame.is_some()
+    }
+
+    /// Starts capturing a new frame for the specified device/window combination.
+    ///
+    /// If the previous frame was never ended, it is discarded first.
+    pub fn begin_frame<D>(&mut self, rd: &mut RenderDoc<V140>, dev: D, win: WindowHandle)
+    where
+        D: Into<DevicePointer>,
+    {
+        if self.frame.is_some() {
+            self.end_frame_with(rd, |_| false);
+        }
+
+        let device = dev.into();
+        let started = Instant::now();
+        rd.start_frame_capture(device.clone(), win);
+
+        self.frame = Some(Frame {
+            device,
+            window: win,
+            started,
+            start_overhead: started.elapsed(),
+        });
+    }
+
+    /// Ends the current frame, keeping the capture if the frame took longer than the threshold.
+    ///
+    /// Returns `true` if the capture was saved to disk, or `false` if it was discarded or no frame
+    /// was being captured.
+    pub fn end_frame(&mut self, rd: &mut RenderDoc<V140>) -> bool {
+        let threshold = self.threshold;
+        self.end_frame_with(rd, |frame_time| match threshold {
+            Some(threshold) => frame_time > threshold,
+            None => false,
+        })
+    }
+
+    /// Ends the current frame, keeping the capture if `keep` returns `true`.
+    ///
+    /// The predicate receives the time elapsed since the frame was started. Returns `true` if the
+    /// capture was saved to disk, or `false` if it was discarded or no frame was being captured.
+    pub fn end_frame_with<F>(&mut self, rd: &mut RenderDoc<V140>, keep: F) -> bool
+    where
+        F: FnOnce(Duration) -> bool,
+    {
+        let frame = match self.frame.take() {
+            Some(frame) => frame,
+            None => return false,
+        };
+
+        let frame_time = frame.started.elapsed();
+        let keep = keep(frame_time);
+
+        let ended = Instant::now();
+        if keep {
+            rd.end_frame_capture(frame.device, frame.window);
+        } else {
+            rd.discard_frame_capture(frame.device, frame.window);
+        }
+        let end_overhead = ended.elapsed();
+
+        self.stats.frames += 1;
+        if keep {
+            self.stats.committed += 1;
+            self.stats.commit_time += end_overhead;
+        } else {
+            self.stats.discarded += 1;
+            self.stats.discard_overhead += frame.start_overhead + end_overhead;
+        }
+
+        keep
+    }
+}
+
+impl Default for RollingCapture {
+    fn default() -> Self {
+        RollingCapture::new()
+    }
+}
+
+/// Statistics collected by a `RollingCapture`.
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct RollingCaptureStats {
+    /// Number of frames which have been ended.
+    pub frames: u64,
+    /// Number of frames whose captures were saved to disk.
+    pub committed: u64,
+    /// Number of frames whose captures were discarded.
+    pub discarded: u64,
+    /// Total time spent in `end_frame_capture()` saving the kept captures.
+    pub commit_time: Duration,
+    /// Total time spent in `start_frame_capture()` and `discard_frame_capture()` for frames whose
+    /// captures were discarded.
+    ///
+    /// This is the price paid for capturing continuously.
+    pub discard_overhead: Duration,
+}
+
+impl RollingCaptureStats {
+    /// Returns the average overhead added to each discarded frame.
+    pub fn mean_discard_overhead(&self) -> Duration {
+        if self.discarded == 0 {
+            return Duration::default();
+        }
+
+        let nanos = self.discard_overhead.as_nanos() / u128::from(self.discarded);
+        Duration::from_nanos(nanos as u64)
+    }
+}
+
+#[cfg(test)]
+#[cfg(all(feature = "mock", not(feature = "disabled")))]
+mod tests {
+    use super::*;
+    use crate::mock::{self, Function};
+    use std::ptr;
+
+    fn calls() -> [u64; 3] {
+        [
+            mock::call_count(Function::StartFrameCapture),
+            mock::call_count(Function::EndFrameCapture),
+            mock::call_count(Function::DiscardFrameCapture),
+        ]
+    }
+
+    #[test]
+    fn keeps_selected_frames_and_discards_the_rest() {
+        let _lock = mock::lock_for_test();
+        let mut rd = unsafe { RenderDoc::<V140>::from_raw(mock::entry()).unwrap() };
+        let mut rolling = RollingCapture::new();
+        let since = |before: [u64; 3]| {
+            let after = calls();
+            [
+                after[0] - before[0],
+                after[1] - before[1],
+                after[2] - before[2],
+            ]
+        };
+
+        // Keep the last frame of every four.
+        let before = calls();
+        for frame in 0..10 {
+            rolling.begin_frame(&mut rd, ptr::null(), ptr::null());
+            assert!(rolling.is_capturing());
+            assert_eq!(
+                rolling.end_frame_with(&mut rd, |_| frame % 4 == 3),
+                frame % 4 == 3
+            );
+        }
+        assert_eq!(since(before), [10, 2, 8]);
+        assert_eq!(rolling.stats().frames, 10);
+        assert_eq!(rolling.stats().committed, 2);
+        assert_eq!(rolling.stats().discarded, 8);
+
+        // An unfinished frame is discarded when the next one begins, and nothing is ended twice.
+        let before = calls();
+        rolling.set_threshold(Duration::from_secs(3600));
+        rolling.begin_frame(&mut rd, ptr::null(), ptr::null());
+        rolling.begin_frame(&mut rd, ptr::null(), ptr::null());
+        assert!(!rolling.end_frame(&mut rd));
+        assert!(!rolling.end_frame(&mut rd));
+        assert!(!rolling.is_capturing());
+        assert_eq!(since(before), [2, 0, 2]);
+        assert_eq!(rolling.stats().discarded, 10);
+    }
+}
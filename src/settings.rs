@@ -64,6 +64,48 @@ pub enum CaptureOption {
         renderdoc_sys::eRENDERDOC_Option_AllowUnsupportedVendorExtensions,
 }
 
+impl CaptureOption {
+    /// Every capture option, ordered by raw value.
+    pub(crate) const ALL: [CaptureOption; 13] = [
+        CaptureOption::AllowVSync,
+        CaptureOption::AllowFullscreen,
+        CaptureOption::ApiValidation,
+        CaptureOption::CaptureCallstacks,
+        CaptureOption::CaptureCallstacksOnlyDraws,
+        CaptureOption::DelayForDebugger,
+        CaptureOption::VerifyMapWrites,
+        CaptureOption::HookIntoChildren,
+        CaptureOption::RefAllResources,
+        CaptureOption::SaveAllInitials,
+        CaptureOption::CaptureAllCmdLists,
+        CaptureOption::DebugOutputMute,
+        CaptureOption::AllowUnsupportedVendorExtensions,
+    ];
+
+    /// Returns the position of this option in `ALL`.
+    pub(crate) fn index(self) -> usize {
+        self as usize
+    }
+
+    /// Returns the value RenderDoc stores when this option is set to `val` as a `u32`.
+    ///
+    /// Every option except `DelayForDebugger` is a boolean, so any non-zero value reads back as 1.
+    pub(crate) fn stored_u32(self, val: u32) -> u32 {
+        match self {
+            CaptureOption::DelayForDebugger => val,
+            _ => (val != 0) as u32,
+        }
+    }
+
+    /// Returns the value RenderDoc stores when this option is set to `val` as an `f32`.
+    pub(crate) fn stored_f32(self, val: f32) -> u32 {
+        match self {
+            CaptureOption::DelayForDebugger => val as u32,
+            _ => (val != 0.0) as u32,
+        }
+    }
+}
+
 /// User input key codes.
 #[allow(missing_docs)]
 #[repr(u32)]
@@ -0,0 +1,287 @@
+//! Process-wide cached copy of RenderDoc state read or set through `RenderDoc` handles.
+
+#[cfg(not(feature = "disabled"))]
+use std::ptr;
+#[cfg(not(feature = "disabled"))]
+use std::sync::atomic::{AtomicPtr, AtomicU16, AtomicU32, AtomicU64, Ordering};
+
+use crate::settings::CaptureOption;
+use crate::version::Entry;
+
+/// Bit of `Mirror::overlay` which marks the overlay bits in its low 32 bits as known.
+#[cfg(not(feature = "disabled"))]
+const OVERLAY_KNOWN: u64 = 1 << 32;
+
+/// Shift of the generation counter in `Mirror::overlay`, which is bumped on every change.
+#[cfg(not(feature = "disabled"))]
+const OVERLAY_GENERATION_SHIFT: u32 = 33;
+
+/// Most recently created mirror, linking to the mirrors of every other API entry point handles
+/// have been created for.
+///
+/// RenderDoc keeps its capture options and overlay bits in global state, so all handles wrapping
+/// the same entry point share one mirror. Mirrors are only ever prepended and never freed, since
+/// there is only one per entry point, so looking one up takes no lock.
+#[cfg(not(feature = "disabled"))]
+static MIRRORS: AtomicPtr<Mirror> = AtomicPtr::new(ptr::null_mut());
+
+/// Capture options and overlay bits last read from or written to RenderDoc through any handle
+/// wrapping one entry point.
+///
+/// Values are only cached once they are known, so a fresh mirror never answers on behalf of the
+/// library.
+#[cfg(not(feature = "disabled"))]
+#[derive(Debug, Default)]
+struct Mirror {
+    entry: usize,
+    next: Option<&'static Mirror>,
+    options: [AtomicU32; CaptureOption::ALL.len()],
+    /// Overlay bits, `OVERLAY_KNOWN` and the generation counter packed together, so that they
+    /// change atomically.
+    overlay: AtomicU64,
+    known: AtomicU16,
+}
+
+#[cfg(not(feature = "disabled"))]
+impl Mirror {
+    /// Returns the mirror of `entry` among `head` and the mirrors it links to, stopping at
+    /// `until`.
+    fn find(head: *mut Mirror, until: *mut Mirror, entry: usize) -> Option<&'static Mirror> {
+        // SAFETY: Published mirrors are leaked, so every pointer in the list stays valid.
+        let mut next = unsafe { head.as_ref() };
+        while let Some(mirror) = next {
+            if ptr::eq(mirror, until) {
+                break;
+            } else if mirror.entry == entry {
+                return Some(mirror);
+            }
+
+            next = mirror.next;
+        }
+
+        None
+    }
+
+    /// Replaces the overlay bits and `OVERLAY_KNOWN` with the value returned by `f`, bumping the
+    /// generation, unless `f` returns `None`.
+    fn update_overlay<F: FnMut(u64) -> Option<u64>>(&self, mut f: F) {
+        let _ = self
+            .overlay
+            .fetch_update(Ordering::AcqRel, Ordering::Acquire, |state| {
+                let generation = (state >> OVERLAY_GENERATION_SHIFT).wrapping_add(1);
+                f(state).map(|value| generation << OVERLAY_GENERATION_SHIFT | value)
+            });
+    }
+}
+
+/// Handle to the mirror of the RenderDoc state shared by every handle wrapping the same entry
+/// point.
+#[cfg(not(feature = "disabled"))]
+#[derive(Clone, Copy, Debug)]
+pub(crate) struct Shadow(&'static Mirror);
+
+#[cfg(not(feature = "disabled"))]
+impl Shadow {
+    /// Returns the mirror of the state behind `entry`, creating it if this is the first handle.
+    pub fn of(entry: *mut Entry) -> Self {
+        let key = entry as usize;
+        let mut head = MIRRORS.load(Ordering::Acquire);
+        if let Some(mirror) = Mirror::find(head, ptr::null_mut(), key) {
+            return Shadow(mirror);
+        }
+
+        let mirror = Box::into_raw(Box::new(Mirror {
+            entry: key,
+            ..Mirror::default()
+        }));
+
+        loop {
+            // SAFETY: `mirror` is not shared with any other thread until it is published.
+            unsafe { (*mirror).next = head.as_ref() };
+            match MIRRORS.compare_exchange(head, mirror, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) => return Shadow(unsafe { &*mirror }),
+                Err(current) => {
+                    // NOTE: Another thread may have published a mirror for the same entry point.
+                    if let Some(existing) = Mirror::find(current, head, key) {
+                        drop(unsafe { Box::from_raw(mirror) });
+                        return Shadow(existing);
+                    }
+
+                    head = current;
+                }
+            }
+        }
+    }
+
+    /// Returns the cached value of `opt`, if known.
+    #[inline]
+    pub fn option(&self, opt: CaptureOption) -> Option<u32> {
+        let i = opt.index();
+        if self.0.known.load(Ordering::Acquire) & (1 << i) != 0 {
+            Some(self.0.options[i].load(Ordering::Relaxed))
+        } else {
+            None
+        }
+    }
+
+    /// Records that RenderDoc now stores `val` for `opt`.
+    #[inline]
+    pub fn set_option(&self, opt: CaptureOption, val: u32) {
+        let i = opt.index();
+        self.0.options[i].store(val, Ordering::Relaxed);
+        self.0.known.fetch_or(1 << i, Ordering::Release);
+    }
+
+    /// Returns the cached overlay bits, if known.
+    #[inline]
+    pub fn overlay(&self) -> Option<u32> {
+        let state = self.0.overlay.load(Ordering::Acquire);
+        if state & OVERLAY_KNOWN != 0 {
+            Some(state as u32)
+        } else {
+            None
+        }
+    }
+
+    /// Returns the generation of the cached overlay bits, to be passed to `fill_overlay()`.
+    #[inline]
+    pub fn overlay_generation(&self) -> u64 {
+        self.0.overlay.load(Ordering::Acquire) >> OVERLAY_GENERATION_SHIFT
+    }
+
+    /// Caches `bits` read from RenderDoc, unless the overlay bits have become known or changed
+    /// since `overlay_generation()` returned `generation`.
+    #[inline]
+    pub fn fill_overlay(&self, generation: u64, bits: u32) {
+        self.0.update_overlay(|state| {
+            let unchanged = state >> OVERLAY_GENERATION_SHIFT == generation;
+            if unchanged && state & OVERLAY_KNOWN == 0 {
+                Some(OVERLAY_KNOWN | bits as u64)
+            } else {
+                None
+            }
+        });
+    }
+
+    /// Applies the same masks to the cached overlay bits as `MaskOverlayBits` does, if known.
+    ///
+    /// The generation is bumped even if the bits are unknown, so that bits read from RenderDoc
+    /// before the mask are not cached by a concurrent `fill_overlay()`.
+    #[inline]
+    pub fn mask_overlay(&self, and: u32, or: u32) {
+        self.0.update_overlay(|state| {
+            if state & OVERLAY_KNOWN != 0 {
+                Some(OVERLAY_KNOWN | (state as u32 & and | or) as u64)
+            } else {
+                Some(0)
+            }
+        });
+    }
+
+    /// Marks every cached value as unknown, for every handle.
+    pub fn clear(&self) {
+        self.0.known.store(0, Ordering::Release);
+        self.0.update_overlay(|_| Some(0));
+    }
+}
+
+/// Mirror of RenderDoc state, which caches nothing since a disabled backend has no state.
+#[cfg(feature = "disabled")]
+#[derive(Clone, Copy, Debug)]
+pub(crate) struct Shadow;
+
+#[cfg(feature = "disabled")]
+#[allow(unused_variables)]
+impl Shadow {
+    #[inline(always)]
+    pub fn of(entry: *mut Entry) -> Self {
+        Shadow
+    }
+
+    #[inline(always)]
+    pub fn option(&self, opt: CaptureOption) -> Option<u32> {
+        None
+    }
+
+    #[inline(always)]
+    pub fn set_option(&self, opt: CaptureOption, val: u32) {}
+
+    #[inline(always)]
+    pub fn overlay(&self) -> Option<u32> {
+        None
+    }
+
+    #[inline(always)]
+    pub fn overlay_generation(&self) -> u64 {
+        0
+    }
+
+    #[inline(always)]
+    pub fn fill_overlay(&self, generation: u64, bits: u32) {}
+
+    #[inline(always)]
+    pub fn mask_overlay(&self, and: u32, or: u32) {}
+
+    #[inline(always)]
+    pub fn clear(&self) {}
+}
+
+#[cfg(test)]
+#[cfg(not(feature = "disabled"))]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn handles_share_mirror_per_entry() {
+        static ENTRIES: [u64; 2] = [0; 2];
+        let entry = &ENTRIES[0] as *const u64 as *mut Entry;
+        let (a, b) = (Shadow::of(entry), Shadow::of(entry));
+
+        a.mask_overlay(0, 0b10);
+        assert_eq!(b.overlay(), None);
+
+        let generation = a.overlay_generation();
+        b.mask_overlay(0, 0b1);
+        a.fill_overlay(generation, 0b11);
+        assert_eq!(b.overlay(), None);
+
+        a.fill_overlay(a.overlay_generation(), 0b11);
+        b.mask_overlay(!0b01, 0b100);
+        assert_eq!(a.overlay(), Some(0b110));
+
+        a.set_option(CaptureOption::DelayForDebugger, 3);
+        assert_eq!(b.option(CaptureOption::DelayForDebugger), Some(3));
+
+        let other = Shadow::of(&ENTRIES[1] as *const u64 as *mut Entry);
+        assert_eq!(other.option(CaptureOption::DelayForDebugger), None);
+
+        b.clear();
+        assert_eq!(a.overlay(), None);
+        assert_eq!(a.option(CaptureOption::DelayForDebugger), None);
+    }
+
+    #[test]
+    #[cfg(feature = "mock")]
+    fn options_written_through_one_handle_are_read_through_another() {
+        use crate::mock::{self, Function};
+        use crate::renderdoc::RenderDoc;
+        use crate::version::V141;
+
+        let _lock = mock::lock_for_test();
+        let mut a = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+        let b = unsafe { RenderDoc::<V141>::from_raw(mock::entry()).unwrap() };
+
+        let reads = mock::call_count(Function::GetCaptureOptionU32);
+        a.set_capture_option_u32(CaptureOption::CaptureAllCmdLists, 1);
+        assert_eq!(
+            b.get_capture_option_u32(CaptureOption::CaptureAllCmdLists),
+            1
+        );
+        a.set_capture_option_u32(CaptureOption::CaptureAllCmdLists, 0);
+        assert_eq!(
+            b.get_capture_option_u32(CaptureOption::CaptureAllCmdLists),
+            0
+        );
+        assert_eq!(mock::call_count(Function::GetCaptureOptionU32), reads);
+    }
+}
@@ -1,7 +1,10 @@
 //! Entry points for the RenderDoc API.
 
+use std::fmt::{self, Display, Formatter};
 use std::os::raw::c_void;
 use std::path::Path;
+use std::ptr;
+use std::sync::atomic::{AtomicPtr, Ordering};
 
 use libloading::{Library, Symbol};
 use once_cell::sync::OnceCell;
@@ -11,6 +14,14 @@ use crate::error::Error;
 
 static RD_LIB: OnceCell<Library> = OnceCell::new();
 
+#[allow(clippy::declare_interior_mutable_const)]
+const UNRESOLVED: AtomicPtr<Entry> = AtomicPtr::new(ptr::null_mut());
+
+/// Entry points returned by `RENDERDOC_GetAPI`, indexed by `VersionCode::index()`.
+///
+/// A null pointer means the version has not been requested successfully yet.
+static ENTRIES: [AtomicPtr<Entry>; VersionCode::COUNT] = [UNRESOLVED; VersionCode::COUNT];
+
 #[cfg(windows)]
 fn get_path() -> &'static Path {
     Path::new("renderdoc.dll")
@@ -26,12 +37,56 @@ fn get_path() -> &'static Path {
     Path::new("libVkLayer_GLES_RenderDoc.so")
 }
 
+/// Opens the RenderDoc library only if it is already loaded into the current process.
+#[cfg(unix)]
+unsafe fn open_loaded(path: &Path) -> Option<Library> {
+    use libloading::os::unix::{Library, RTLD_NOW};
+
+    Library::open(Some(path), RTLD_NOW | libc::RTLD_NOLOAD)
+        .ok()
+        .map(From::from)
+}
+
+/// Opens the RenderDoc library only if it is already loaded into the current process.
+#[cfg(windows)]
+unsafe fn open_loaded(path: &Path) -> Option<Library> {
+    use libloading::os::windows::Library;
+
+    Library::open_already_loaded(path).ok().map(From::from)
+}
+
+/// Returns the RenderDoc library if it is loaded into the current process, without searching the
+/// file system for it.
+fn loaded_library() -> Option<&'static Library> {
+    if let Some(lib) = RD_LIB.get() {
+        return Some(lib);
+    }
+
+    let lib = unsafe { open_loaded(get_path())? };
+    Some(RD_LIB.get_or_init(|| lib))
+}
+
+/// Requests the entry point for `version` from `lib`.
+///
+/// # Safety
+///
+/// This function is not thread-safe and should not be called on multiple threads at once.
+unsafe fn get_api(lib: &Library, version: VersionCode) -> Result<*mut Entry, Error> {
+    let get_api: Symbol<GetApiFn> = lib.get(b"RENDERDOC_GetAPI\0").map_err(Error::symbol)?;
+
+    let mut obj = ptr::null_mut();
+    match get_api(version, &mut obj) {
+        1 => Ok(obj as *mut Entry),
+        _ => Err(Error::no_compatible_api()),
+    }
+}
+
 /// Entry point for the RenderDoc API.
 pub type Entry = RENDERDOC_API_1_4_1;
 
 /// Available versions of the RenderDoc API.
 #[repr(u32)]
-#[derive(Clone, Copy, Debug, Eq, Hash, PartialEq)]
+#[derive(Clone, Copy, Debug, Eq, Hash, Ord, PartialEq, PartialOrd)]
 pub enum VersionCode {
     /// Version 1.0.0.
     V100 = 10000,
@@ -55,6 +110,32 @@ pub enum VersionCode {
     V141 = 10401,
 }
 
+impl VersionCode {
+    const COUNT: usize = 10;
+
+    fn index(self) -> usize {
+        match self {
+            VersionCode::V100 => 0,
+            VersionCode::V101 => 1,
+            VersionCode::V102 => 2,
+            VersionCode::V110 => 3,
+            VersionCode::V111 => 4,
+            VersionCode::V112 => 5,
+            VersionCode::V120 => 6,
+            VersionCode::V130 => 7,
+            VersionCode::V140 => 8,
+            VersionCode::V141 => 9,
+        }
+    }
+}
+
+impl Display for VersionCode {
+    fn fmt(&self, f: &mut Formatter) -> fmt::Result {
+        let code = *self as u32;
+        write!(f, "{}.{}.{}", code / 10000, code / 100 % 100, code % 100)
+    }
+}
+
 /// Initializes a new instance of the RenderDoc API.
 ///
 /// # Safety
@@ -69,26 +150,80 @@ pub trait Version {
 
     /// Initializes a new instance of the RenderDoc API.
     ///
+    /// The entry point is cached after the first successful call, so subsequent calls for the same
+    /// version only cost a single atomic load.
+    ///
     /// # Safety
     ///
-    /// This function is not thread-safe and should not be called on multiple threads at once.
+    /// The first call for each version is not thread-safe and should not be made on multiple
+    /// threads at once.
     fn load() -> Result<*mut Entry, Error> {
-        use std::ptr;
+        let slot = &ENTRIES[Self::VERSION.index()];
+        let cached = slot.load(Ordering::Acquire);
+        if !cached.is_null() {
+            return Ok(cached);
+        }
+
+        // NOTE: Racing threads may both reach `RENDERDOC_GetAPI`, which hands out the same
+        // pointer for a given version, so whichever store wins is equivalent.
+        let entry = Self::load_uncached()?;
+        slot.store(entry, Ordering::Release);
+        Ok(entry)
+    }
+
+    /// Requests the entry point from the library, bypassing the cache used by `load()`.
+    ///
+    /// # Safety
+    ///
+    /// This function is not thread-safe and should not be called on multiple threads at once.
+    #[doc(hidden)]
+    fn load_uncached() -> Result<*mut Entry, Error> {
+        #[cfg(feature = "mock")]
+        unsafe {
+            if crate::mock::is_enabled() {
+                let mut obj = ptr::null_mut();
+                return match crate::mock::get_api(Self::VERSION, &mut obj) {
+                    1 => Ok(obj as *mut Entry),
+                    _ => Err(Error::no_compatible_api()),
+                };
+            }
+        }
 
         unsafe {
             let lib = RD_LIB
                 .get_or_try_init(|| Library::new(get_path()))
                 .map_err(Error::library)?;
 
-            let get_api: Symbol<GetApiFn> =
-                lib.get(b"RENDERDOC_GetAPI\0").map_err(Error::symbol)?;
+            get_api(lib, Self::VERSION)
+        }
+    }
+
+    /// Binds to the RenderDoc API only if the library is already loaded into the process.
+    ///
+    /// Unlike `load()`, this never searches the file system or loads the library. Returns `None`
+    /// if RenderDoc has not been injected, or if it does not support this version.
+    ///
+    /// # Safety
+    ///
+    /// The first call for each version is not thread-safe and should not be made on multiple
+    /// threads at once.
+    fn attach() -> Option<*mut Entry> {
+        let slot = &ENTRIES[Self::VERSION.index()];
+        let cached = slot.load(Ordering::Acquire);
+        if !cached.is_null() {
+            return Some(cached);
+        }
 
-            let mut obj = ptr::null_mut();
-            match get_api(Self::VERSION, &mut obj) {
-                1 => Ok(obj as *mut Entry),
-                _ => Err(Error::no_compatible_api()),
+        #[cfg(feature = "mock")]
+        {
+            if crate::mock::is_enabled() {
+                return Self::load().ok();
             }
         }
+
+        let entry = unsafe { get_api(loaded_library()?, Self::VERSION).ok()? };
+        slot.store(entry, Ordering::Release);
+        Some(entry)
     }
 }
 
@@ -0,0 +1,359 @@
+//! Finalization of frame captures on a dedicated thread.
+
+use std::future::Future;
+use std::os::raw::c_void;
+use std::path::{Path, PathBuf};
+use std::pin::Pin;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::mpsc::{self, Sender};
+use std::sync::{Arc, Condvar, Mutex};
+use std::task::{Context, Poll, Waker};
+use std::thread::{self, JoinHandle};
+use std::time::{Duration, Instant, SystemTime};
+
+use crate::backend::Backend;
+use crate::error::Error;
+use crate::handles::{DevicePointer, WindowHandle};
+use crate::renderdoc::RenderDoc;
+use crate::version::V100;
+
+/// A capture which was saved to disk by a `CaptureWorker`.
+#[derive(Clone, Debug, Eq, Hash, PartialEq)]
+pub struct FinishedCapture {
+    path: PathBuf,
+    capture_time: SystemTime,
+    stall: Duration,
+}
+
+impl FinishedCapture {
+    /// Returns the path of the capture file.
+    pub fn path(&self) -> &Path {
+        &self.path
+    }
+
+    /// Returns the time at which the capture was made.
+    pub fn capture_time(&self) -> SystemTime {
+        self.capture_time
+    }
+
+    /// Returns how long `end_frame_capture()` blocked the worker thread, which is the time the
+    /// calling thread would otherwise have stalled for.
+    pub fn stall(&self) -> Duration {
+        self.stall
+    }
+}
+
+/// Counters describing the work done by a `CaptureWorker`.
+#[derive(Clone, Copy, Debug, Default, Eq, Hash, PartialEq)]
+pub struct CaptureWorkerStats {
+    /// Number of captures still waiting to be finalized.
+    pub pending: u64,
+    /// Number of captures saved to disk.
+    pub finished: u64,
+    /// Number of captures which RenderDoc failed to end.
+    pub failed: u64,
+    /// Total time spent blocked in `end_frame_capture()` on the worker thread.
+    pub total_stall: Duration,
+    /// Longest single call to `end_frame_capture()` on the worker thread.
+    pub max_stall: Duration,
+}
+
+/// Ends frame captures on a dedicated thread, so the calling thread does not stall while
+/// RenderDoc serializes the capture to disk.
+///
+/// Capture starts as usual with `RenderDoc::start_frame_capture()`. Ending it through
+/// [`end_frame_capture()`] returns immediately with a [`PendingCapture`], which resolves to the
+/// saved capture once RenderDoc has finished writing it. Alternatively,
+/// [`end_frame_capture_with()`] invokes a callback on the worker thread.
+///
+/// Only use this with graphics APIs whose devices are not bound to a thread, such as Vulkan and
+/// D3D12. With OpenGL or D3D11, RenderDoc must end the capture on the thread which owns the
+/// context.
+///
+/// [`end_frame_capture()`]: #method.end_frame_capture
+/// [`end_frame_capture_with()`]: #method.end_frame_capture_with
+/// [`PendingCapture`]: ./struct.PendingCapture.html
+///
+/// # Examples
+///
+/// ```rust,no_run
+/// # use renderdoc::{CaptureWorker, Error, RenderDoc, V141};
+/// # fn main() -> Result<(), Error> {
+/// let mut renderdoc: RenderDoc<V141> = RenderDoc::new()?;
+/// let worker = CaptureWorker::new(&renderdoc);
+///
+/// renderdoc.start_frame_capture(std::ptr::null(), std::ptr::null());
+/// // Do some rendering here...
+/// let pending = worker.end_frame_capture(std::ptr::null(), std::ptr::null());
+///
+/// // Keep rendering while the capture is written, then later:
+/// let capture = pending.wait()?;
+/// println!("Saved {:?}, saving {:?} of stall", capture.path(), capture.stall());
+/// # Ok(())
+/// # }
+/// ```
+#[derive(Debug)]
+pub struct CaptureWorker {
+    sender: Sender<Job>,
+    thread: Option<JoinHandle<()>>,
+    stats: Arc<WorkerStats>,
+}
+
+impl CaptureWorker {
+    /// Spawns a worker thread which ends captures through the same API instance as `renderdoc`.
+    pub fn new(renderdoc: &RenderDoc<V100>) -> Self {
+        let mut renderdoc = renderdoc.duplicate();
+        let stats = Arc::new(WorkerStats::default());
+        let (sender, receiver) = mpsc::channel::<Job>();
+
+        let thread_stats = stats.clone();
+        let thread = thread::Builder::new()
+            .name("renderdoc-capture".into())
+            .spawn(move || {
+                for job in receiver {
+                    let result = finalize(&mut renderdoc, &job, &thread_stats);
+                    job.reply.send(result);
+                }
+            })
+            .expect("Failed to spawn capture thread");
+
+        CaptureWorker {
+            sender,
+            thread: Some(thread),
+            stats,
+        }
+    }
+
+    /// Ends the active frame capture on the worker thread, returning a handle to the result.
+    ///
+    /// Data for the capture is saved to disk by RenderDoc without blocking the calling thread.
+    /// If either or both `dev` and `win` are set to `std::ptr::null()`, then RenderDoc will
+    /// perform a wildcard match.
+    pub fn end_frame_capture<D>(&self, dev: D, win: WindowHandle) -> PendingCapture
+    where
+        D: Into<DevicePointer>,
+    {
+        let slot = Arc::new(Slot::default());
+        self.submit(dev.into(), win, Reply::Slot(slot.clone()));
+        PendingCapture { slot }
+    }
+
+    /// Ends the active frame capture on the worker thread, calling `callback` with the result.
+    ///
+    /// The callback runs on the worker thread and delays any captures ended after this one, so it
+    /// should return quickly.
+    pub fn end_frame_capture_with<D, F>(&self, dev: D, win: WindowHandle, callback: F)
+    where
+        D: Into<DevicePointer>,
+        F: FnOnce(Result<FinishedCapture, Error>) + Send + 'static,
+    {
+        self.submit(dev.into(), win, Reply::Callback(Box::new(callback)));
+    }
+
+    /// Returns the current counters of the worker.
+    pub fn stats(&self) -> CaptureWorkerStats {
+        let submitted = self.stats.submitted.load(Ordering::Relaxed);
+        let finished = self.stats.finished.load(Ordering::Relaxed);
+        let failed = self.stats.failed.load(Ordering::Relaxed);
+
+        CaptureWorkerStats {
+            pending: submitted.saturating_sub(finished + failed),
+            finished,
+            failed,
+            total_stall: Duration::from_nanos(self.stats.total_stall.load(Ordering::Relaxed)),
+            max_stall: Duration::from_nanos(self.stats.max_stall.load(Ordering::Relaxed)),
+        }
+    }
+
+    fn submit(&self, dev: DevicePointer, win: WindowHandle, reply: Reply) {
+        let DevicePointer(dev) = dev;
+        let job = Job {
+            dev: dev as *mut c_void,
+            win: win as *mut c_void,
+            reply,
+        };
+
+        self.stats.submitted.fetch_add(1, Ordering::Relaxed);
+        if let Err(mpsc::SendError(job)) = self.sender.send(job) {
+            self.stats.failed.fetch_add(1, Ordering::Relaxed);
+            job.reply.send(Err(Error::end_frame_capture()));
+        }
+    }
+}
+
+impl Drop for CaptureWorker {
+    fn drop(&mut self) {
+        // Closing the channel lets the thread finish the remaining captures and exit.
+        let (sender, _) = mpsc::channel();
+        drop(std::mem::replace(&mut self.sender, sender));
+        if let Some(thread) = self.thread.take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// A frame capture which is being finalized by a `CaptureWorker`.
+///
+/// This can either be awaited as a `Future` on any executor, or waited on with [`wait()`].
+///
+/// [`wait()`]: #method.wait
+#[derive(Debug)]
+pub struct PendingCapture {
+    slot: Arc<Slot>,
+}
+
+impl PendingCapture {
+    /// Returns whether the capture has been finalized, successfully or not.
+    pub fn is_finished(&self) -> bool {
+        self.slot.state.lock().unwrap().result.is_some()
+    }
+
+    /// Blocks the current thread until the capture has been finalized.
+    pub fn wait(self) -> Result<FinishedCapture, Error> {
+        let mut state = self.slot.state.lock().unwrap();
+        loop {
+            match state.result.take() {
+                Some(result) => return result,
+                None => state = self.slot.ready.wait(state).unwrap(),
+            }
+        }
+    }
+}
+
+impl Future for PendingCapture {
+    type Output = Result<FinishedCapture, Error>;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<Self::Output> {
+        let mut state = self.slot.state.lock().unwrap();
+        match state.result.take() {
+            Some(result) => Poll::Ready(result),
+            None => {
+                let stale = state
+                    .waker
+                    .as_ref()
+                    .map_or(true, |w| !w.will_wake(cx.waker()));
+                if stale {
+                    state.waker = Some(cx.waker().clone());
+                }
+                Poll::Pending
+            }
+        }
+    }
+}
+
+/// Ends a single capture and reports the capture RenderDoc saved for it.
+fn finalize(
+    renderdoc: &mut RenderDoc<V100>,
+    job: &Job,
+    stats: &WorkerStats,
+) -> Result<FinishedCapture, Error> {
+    let count_before = renderdoc.get_num_captures();
+    let start = Instant::now();
+    let ended = unsafe { renderdoc.table().end_frame_capture(job.dev, job.win) } == 1;
+    let stall = start.elapsed();
+
+    let nanos = stall.as_secs() * 1_000_000_000 + u64::from(stall.subsec_nanos());
+    stats.total_stall.fetch_add(nanos, Ordering::Relaxed);
+    stats.max_stall.fetch_max(nanos, Ordering::Relaxed);
+
+    // The capture saved by this call is the first one appended to the list while it ran. If
+    // nothing was appended, reporting the last entry would attribute an older capture to it.
+    let saved = ended && renderdoc.get_num_captures() > count_before;
+    match renderdoc.get_capture(count_before).filter(|_| saved) {
+        Some((path, capture_time)) => {
+            stats.finished.fetch_add(1, Ordering::Relaxed);
+            Ok(FinishedCapture {
+                path,
+                capture_time,
+                stall,
+            })
+        }
+        _ => {
+            stats.failed.fetch_add(1, Ordering::Relaxed);
+            Err(Error::end_frame_capture())
+        }
+    }
+}
+
+#[derive(Debug, Default)]
+struct WorkerStats {
+    submitted: AtomicU64,
+    finished: AtomicU64,
+    failed: AtomicU64,
+    total_stall: AtomicU64,
+    max_stall: AtomicU64,
+}
+
+/// Request to end a capture, sent to the worker thread.
+struct Job {
+    dev: *mut c_void,
+    win: *mut c_void,
+    reply: Reply,
+}
+
+// NOTE: The device and window handles are only passed back into RenderDoc, which accepts them
+// from any thread for the graphics APIs `CaptureWorker` is meant for.
+unsafe impl Send for Job {}
+
+/// Destination of the result of a `Job`.
+enum Reply {
+    Slot(Arc<Slot>),
+    Callback(Box<dyn FnOnce(Result<FinishedCapture, Error>) + Send>),
+}
+
+impl Reply {
+    fn send(self, result: Result<FinishedCapture, Error>) {
+        match self {
+            Reply::Slot(slot) => {
+                let waker = {
+                    let mut state = slot.state.lock().unwrap();
+                    state.result = Some(result);
+                    state.waker.take()
+                };
+
+                slot.ready.notify_all();
+                if let Some(waker) = waker {
+                    waker.wake();
+                }
+            }
+            Reply::Callback(callback) => callback(result),
+        }
+    }
+}
+
+#[derive(Debug, Default)]
+struct Slot {
+    state: Mutex<SlotState>,
+    ready: Condvar,
+}
+
+#[derive(Debug, Default)]
+struct SlotState {
+    result: Option<Result<FinishedCapture, Error>>,
+    waker: Option<Waker>,
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::version::V141;
+    use std::ptr;
+
+    #[test]
+    fn failed_captures_are_reported() {
+        let renderdoc = RenderDoc::<V141>::disabled();
+        let worker = CaptureWorker::new(&renderdoc);
+
+        let pending = worker.end_frame_capture(ptr::null(), ptr::null());
+        assert!(pending.wait().is_err());
+
+        let (sender, receiver) = mpsc::channel();
+        worker.end_frame_capture_with(ptr::null(), ptr::null(), move |result| {
+            sender.send(result.is_err()).unwrap();
+        });
+        assert!(receiver.recv().unwrap());
+
+        let stats = worker.stats();
+        assert_eq!((stats.pending, stats.finished, stats.failed), (0, 0, 2));
+    }
+}
@@ -0,0 +1,21 @@
+//! Checks version negotiation of `RenderDoc::new_best()` against the mock backend.
+//!
+//! This is a separate test binary, since selecting the mock for `RenderDoc::new()` affects the
+//! whole process.
+
+use renderdoc::mock::{self, Function};
+use renderdoc::{RenderDoc, VersionCode, V141};
+
+#[test]
+fn new_best_negotiates_once() {
+    mock::enable();
+
+    let first = RenderDoc::new_best().unwrap();
+    assert_eq!(first.version(), VersionCode::V141);
+    assert!(first.get::<V141>().is_ok());
+
+    let probes = mock::call_count(Function::GetApiVersion);
+    let second = RenderDoc::new_best().unwrap();
+    assert_eq!(second.version(), VersionCode::V141);
+    assert_eq!(mock::call_count(Function::GetApiVersion), probes);
+}
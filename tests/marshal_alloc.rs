@@ -0,0 +1,68 @@
+//! Checks that string and key arguments are passed to RenderDoc without allocating.
+//!
+//! This is a separate test binary, so its counting global allocator does not replace the
+//! allocator of the library's unit tests.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+use std::ffi::{CStr, OsStr};
+use std::path::Path;
+
+use renderdoc::{InputButton, RenderDoc, V141};
+
+/// Counts the allocations made by the current thread, so concurrently running tests do not
+/// interfere with each other.
+struct CountingAllocator;
+
+thread_local! {
+    static ALLOCATIONS: Cell<usize> = Cell::new(0);
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let _ = ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let _ = ALLOCATIONS.try_with(|n| n.set(n.get() + 1));
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAllocator = CountingAllocator;
+
+fn count_allocations<F: FnOnce()>(f: F) -> usize {
+    let before = ALLOCATIONS.with(Cell::get);
+    f();
+    ALLOCATIONS.with(Cell::get) - before
+}
+
+#[test]
+fn typical_arguments_do_not_allocate() {
+    // The mock copies every path template it receives, so a disabled instance is used to count
+    // only the allocations made converting the arguments.
+    let mut rd = RenderDoc::<V141>::disabled();
+    let template = Path::new("/tmp/captures/game");
+    let comments = CStr::from_bytes_with_nul(b"Hitch in frame 1234\0").unwrap();
+    let keys = [InputButton::F12, InputButton::PrtScrn];
+
+    let allocations = count_allocations(|| {
+        rd.set_capture_file_path_template("/tmp/captures/game");
+        rd.set_capture_file_path_template(template);
+        rd.set_capture_file_path_template(OsStr::new("/tmp/captures/game"));
+        rd.set_capture_file_comments(None, "Hitch in frame 1234");
+        rd.set_capture_file_comments(template, comments);
+        rd.set_capture_file_comments(OsStr::new("/tmp/captures/game_frame1.rdc"), comments);
+        rd.set_capture_keys(&keys);
+        rd.set_focus_toggle_keys(&keys);
+        let _ = rd.launch_replay_ui(true, "--help");
+    });
+
+    assert_eq!(allocations, 0);
+}